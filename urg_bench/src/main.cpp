@@ -0,0 +1,1066 @@
+//
+//  main.cpp
+//  urg_bench
+//
+//  Command-line benchmarks for the recording and display hot paths, run on
+//  synthetic recordings. Results are printed one line per benchmark, as the
+//  benchmark's name followed by key=value pairs.
+//
+//      urg_bench [--scans N] [--beams N] [--noise MM] [--seed N]
+//
+
+#include "ofMain.h"
+#include "urgFormat.h"
+#include "urgScanParser.h"
+#include "urgBeamTable.h"
+#include "urgRecordWriter.h"
+#include "urgBackgroundModel.h"
+#include "urgBlobTracker.h"
+#include "urgCodec.h"
+#include "urgSpscQueue.h"
+#include "urgDisplay.h"
+#include "urgExport.h"
+#include "urgOctree.h"
+#include "urgOutlierFilter.h"
+#include "urgScanCache.h"
+#include "urgScanIndex.h"
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <thread>
+
+#ifndef TARGET_WIN32
+#include <sys/resource.h>
+#endif
+
+// ---------------------------------------------------------------------
+
+// every allocation in the process is counted
+static std::atomic<size_t> nAllocations(0);
+
+void* operator new(size_t size) {
+    nAllocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// seconds since an arbitrary point
+static double now() {
+    using namespace std::chrono;
+    return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+// ---------------------------------------------------------------------
+
+// csv scan lines like the ones urg_record writes: a wall about 2 m away with a little noise
+static vector<string> makeCsvLines(int nScans, int nBeams) {
+
+    vector<string> lines(nScans);
+    vector<float> xy(2 * nBeams);
+    for (int s = 0; s < nScans; s++) {
+        for (int i = 0; i < nBeams; i++) {
+            float theta = ofDegToRad(-120 + 240. * i / (nBeams - 1));
+            float r = 2000 + ofRandom(-20, 20);
+            xy[2 * i] = r * cos(theta);
+            xy[2 * i + 1] = r * sin(theta);
+        }
+        urgAppendCsvScan(lines[s], s * 100, xy.data(), nBeams);
+        lines[s].pop_back(); // newline
+    }
+    return lines;
+}
+
+// ---------------------------------------------------------------------
+
+// parse csv scan lines the way fillLinearMesh used to, and with urgParseScanLine
+static void benchScanParser(int nScans, int nBeams) {
+
+    vector<string> lines = makeCsvLines(nScans, nBeams);
+    vector<float> xy(2 * nBeams);
+    double checksum = 0;
+
+    // ofSplitString + ofToFloat
+    double start = now();
+    for (int s = 0; s < nScans; s++) {
+        vector<string> items = ofSplitString(lines[s], ",");
+        checksum += ofToFloat(items[0]);
+        for (size_t i = 1; i < items.size(); i++) xy[i - 1] = ofToFloat(items[i]);
+        checksum += xy[2 * nBeams - 1];
+    }
+    double splitTime = now() - start;
+
+    // urgParseScanLine
+    start = now();
+    for (int s = 0; s < nScans; s++) {
+        double time;
+        int nValues;
+        urgParseScanLine(lines[s].data(), lines[s].data() + lines[s].size(), time, xy.data(), xy.size(), nValues);
+        checksum += time + xy[2 * nBeams - 1];
+    }
+    double parseTime = now() - start;
+
+    cout << "scan_parser split_scans_per_s=" << nScans / splitTime
+         << " parse_scans_per_s=" << nScans / parseTime
+         << " speedup=" << splitTime / parseTime
+         << " checksum=" << checksum << endl;
+}
+
+// peak resident memory of the process so far (megabytes)
+static double peakRssMB() {
+
+#ifdef TARGET_WIN32
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef TARGET_OSX
+    return usage.ru_maxrss / (1024. * 1024.);   // bytes
+#else
+    return usage.ru_maxrss / 1024.;             // kilobytes
+#endif
+#endif
+}
+
+// ---------------------------------------------------------------------
+
+// one timed benchmark
+struct benchRun {
+    string name;
+    double start;
+    size_t allocations;
+};
+
+static benchRun beginBench(string name) {
+
+    benchRun run;
+    run.name = name;
+    run.allocations = nAllocations;
+    run.start = now();
+    return run;
+}
+
+// print a benchmark's line
+static void endBench(const benchRun& run, unsigned long nScans, size_t nPoints) {
+
+    double seconds = now() - run.start;
+    size_t allocations = nAllocations - run.allocations;
+
+    cout << run.name
+         << " scans=" << nScans
+         << " points=" << nPoints
+         << " seconds=" << seconds
+         << " scans_per_s=" << nScans / seconds
+         << " points_per_s=" << nPoints / seconds
+         << " allocs_per_scan=" << (nScans > 0 ? (double)allocations / nScans : 0)
+         << " peak_rss_mb=" << peakRssMB() << endl;
+}
+
+// ---------------------------------------------------------------------
+
+// what the synthetic sensor sees
+struct benchSettings {
+    int nScans = 2000;
+    int nBeams = 682;
+    float noise = 10;       // mm, uniform
+    int seed = 1;
+};
+
+// scans of a synthetic sensor the way the recorder receives them: ranges (mm)
+// and beam angles (radians) of a room a few meters across, with noise, and
+// some beams close enough to the sensor to be culled
+struct benchScans {
+    vector<int32_t> ranges;     // nScans * nBeams
+    vector<float> angles;       // nBeams
+};
+
+static benchScans makeScans(const benchSettings& settings) {
+
+    benchScans scans;
+    int nBeams = settings.nBeams;
+    scans.angles.resize(nBeams);
+    for (int i = 0; i < nBeams; i++) scans.angles[i] = ofDegToRad(-120 + 240. * i / (nBeams - 1));
+
+    ofSeedRandom(settings.seed);
+    scans.ranges.resize((size_t)settings.nScans * nBeams);
+    for (int s = 0; s < settings.nScans; s++) {
+        for (int i = 0; i < nBeams; i++) {
+            float r = 2500 + 1000 * sin(scans.angles[i] * 3 + s * 0.01) + ofRandom(-settings.noise, settings.noise);
+            if (i % 50 == 0) r = 100;
+            scans.ranges[(size_t)s * nBeams + i] = r;
+        }
+    }
+    return scans;
+}
+
+// ---------------------------------------------------------------------
+
+// the recorder's path for each scan: polar to cartesian, then formatted and
+// written by the writer thread; leaves the recordings behind for the display
+static void benchRecorder(const benchScans& scans, const benchSettings& settings, string csvFileName, string binaryFileName, string compressedFileName, string polarFileName) {
+
+    int nScans = settings.nScans;
+    int nBeams = settings.nBeams;
+    size_t nPoints = (size_t)nScans * nBeams;
+    vector<float> xy((size_t)nScans * 2 * nBeams);
+
+    // polar to cartesian
+    urgBeamTable beamTable;
+    benchRun run = beginBench("record_convert");
+    for (int s = 0; s < nScans; s++) {
+        beamTable.convert(&scans.ranges[(size_t)s * nBeams], scans.angles.data(), nBeams, &xy[(size_t)s * 2 * nBeams]);
+    }
+    endBench(run, nScans, nPoints);
+
+    // formatting and writing in each format (no scans are dropped)
+    string fileNames[] = { csvFileName, binaryFileName, compressedFileName, polarFileName };
+    string runNames[] = { "record_write_csv", "record_write_binary", "record_write_compressed", "record_write_polar" };
+    uint32_t layouts[] = { URG_LAYOUT_CARTESIAN, URG_LAYOUT_CARTESIAN, URG_LAYOUT_DELTA_RANGES, URG_LAYOUT_POLAR };
+    uint64_t sizes[4];
+    for (int f = URG_FORMAT_CSV; f <= URG_FORMAT_POLAR; f++) {
+
+        urgRecordWriter writer;
+        writer.setup(256, URG_QUEUE_BLOCK, nBeams);
+        writer.open(fileNames[f], (urgRecordingFormat)f);
+        if (f != URG_FORMAT_CSV) writer.setHeader(urgMakeHeader(nBeams, ofDegToRad(240. / (nBeams - 1)), scans.angles[0], 0, urgUnixTimeMillis(), layouts[f]), scans.angles.data());
+
+        run = beginBench(runNames[f]);
+        for (int s = 0; s < nScans; s++) writer.push(s * 100, &xy[(size_t)s * 2 * nBeams], nBeams, 0, &scans.ranges[(size_t)s * nBeams]);
+        writer.close();
+        endBench(run, nScans, nPoints);
+
+        sizes[f] = ofFile(fileNames[f], ofFile::ReadOnly, true).getSize();
+    }
+
+    cout << "record_size csv_mb=" << sizes[URG_FORMAT_CSV] / (1024. * 1024.)
+         << " binary_mb=" << sizes[URG_FORMAT_BINARY] / (1024. * 1024.)
+         << " compressed_mb=" << sizes[URG_FORMAT_COMPRESSED] / (1024. * 1024.)
+         << " polar_mb=" << sizes[URG_FORMAT_POLAR] / (1024. * 1024.)
+         << " csv_ratio=" << (double)sizes[URG_FORMAT_CSV] / sizes[URG_FORMAT_COMPRESSED]
+         << " binary_ratio=" << (double)sizes[URG_FORMAT_BINARY] / sizes[URG_FORMAT_COMPRESSED] << endl;
+}
+
+// ---------------------------------------------------------------------
+
+// checks that failed (the bench exits with an error if any did)
+static int nFailedChecks = 0;
+
+// ---------------------------------------------------------------------
+
+// writing each format split into segments, by size and by duration; the
+// whole session, loaded from any of its segments, has to read back exactly
+// like the recording written in one file
+static void benchSegments(const benchScans& scans, const benchSettings& settings, string fileNames[4]) {
+
+    int nScans = settings.nScans;
+    int nBeams = settings.nBeams;
+    vector<float> xy(2 * nBeams);
+    urgBeamTable beamTable;
+
+    string formatNames[] = { "csv", "binary", "compressed", "polar" };
+    uint32_t layouts[] = { URG_LAYOUT_CARTESIAN, URG_LAYOUT_CARTESIAN, URG_LAYOUT_DELTA_RANGES, URG_LAYOUT_POLAR };
+    for (int f = URG_FORMAT_CSV; f <= URG_FORMAT_POLAR; f++) {
+        for (int bySize = 1; bySize >= 0; bySize--) {
+
+            // about 8 segments either way
+            uint64_t wholeSize = ofFile(fileNames[f], ofFile::ReadOnly, true).getSize();
+            uint64_t maxBytes = bySize ? wholeSize / 8 : 0;
+            unsigned long maxMillis = bySize ? 0 : nScans * 100 / 8;
+            string fileName = "bench_segmented_" + formatNames[f] + "." + ofFile(fileNames[f]).getExtension();
+
+            urgRecordWriter writer;
+            writer.setup(256, URG_QUEUE_BLOCK, nBeams);
+            writer.setSegments(maxBytes, maxMillis);
+            writer.open(fileName, (urgRecordingFormat)f);
+            if (f != URG_FORMAT_CSV) writer.setHeader(urgMakeHeader(nBeams, ofDegToRad(240. / (nBeams - 1)), scans.angles[0], 0, urgUnixTimeMillis(), layouts[f]), scans.angles.data());
+
+            string label = "record_segments_" + formatNames[f] + (bySize ? "_by_size" : "_by_time");
+            benchRun run = beginBench(label);
+            for (int s = 0; s < nScans; s++) {
+                beamTable.convert(&scans.ranges[(size_t)s * nBeams], scans.angles.data(), nBeams, xy.data());
+                writer.push(s * 100, xy.data(), nBeams, 0, &scans.ranges[(size_t)s * nBeams]);
+            }
+            writer.close();
+            endBench(run, nScans, (size_t)nScans * nBeams);
+            int nSegments = writer.getSegment() + 1;
+
+            // load the session from its last segment
+            urgRecording whole, session;
+            whole.load(fileNames[f]);
+            session.load(urgSegmentFileName(fileName, nSegments - 1));
+            bool matches = session.getNumSegments() == nSegments && session.getNumScans() == whole.getNumScans();
+            urgScan a, b;
+            for (unsigned long i = 0; matches && i < whole.getNumScans(); i++) {
+                whole.readScan(i, a);
+                session.readScan(i, b);
+                matches = a.time == b.time && a.points.size() == b.points.size() && memcmp(a.points.data(), b.points.data(), a.points.size() * sizeof(ofVec2f)) == 0;
+            }
+            for (unsigned long i = 0; matches && i < whole.getNumScans(); i += 97) {
+                matches = session.findScan(whole.getScanTime(i)) == whole.findScan(whole.getScanTime(i));
+            }
+
+            // no segment keeps the space reserved past its end
+            uint64_t maxSegmentSize = 0, totalSize = 0;
+            for (int i = 0; i < nSegments; i++) {
+                string segmentName = urgSegmentFileName(fileName, i);
+                uint64_t size = ofFile(segmentName, ofFile::ReadOnly, true).getSize();
+                maxSegmentSize = max(maxSegmentSize, size);
+                totalSize += size;
+                ofFile::removeFile(segmentName);
+                ofFile::removeFile(segmentName + ".idx");
+            }
+            cout << label << "_check segments=" << nSegments
+                 << " max_segment_mb=" << maxSegmentSize / (1024. * 1024.)
+                 << " total_mb=" << totalSize / (1024. * 1024.)
+                 << " matches_whole=" << matches << endl;
+            if (!matches || nSegments < 2) nFailedChecks++;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------
+
+// loading a recording that holds ranges (a compressed one only has its
+// scans' times read; chunks are decoded as scans are read from them); it has
+// to read back as exactly the same scans as the binary one
+static void benchRanges(string binaryFileName, string fileName, string label) {
+
+    urgRecording binary, ranges;
+    binary.load(binaryFileName);
+    benchRun run = beginBench("load_decode_" + label);
+    ranges.load(fileName);
+    unsigned long nScans = ranges.getNumScans();
+    endBench(run, nScans, nScans * ranges.getHeader().beamCount);
+
+    bool matches = binary.getNumScans() == nScans;
+    urgScan a, b;
+    for (unsigned long i = 0; matches && i < nScans; i++) {
+        binary.readScan(i, a);
+        ranges.readScan(i, b);
+        matches = a.time == b.time && a.points.size() == b.points.size() && memcmp(a.points.data(), b.points.data(), a.points.size() * sizeof(ofVec2f)) == 0;
+    }
+    cout << label << "_check scans=" << nScans << " matches_binary=" << matches << endl;
+    if (!matches) nFailedChecks++;
+}
+
+// ---------------------------------------------------------------------
+
+// a chunk header claiming more scans than its payload could hold is corrupt,
+// and has to be turned away before its count sizes anything
+static void benchChunkHeader(const benchScans& scans, const benchSettings& settings) {
+
+    urgChunkEncoder encoder;
+    encoder.setup(settings.nBeams, 16);
+    for (int i = 0; i < 16; i++) encoder.add(i * 100, &scans.ranges[(size_t)i * settings.nBeams], settings.nBeams);
+    string chunk = encoder.getChunk();
+
+    urgChunkHeader header;
+    bool valid = urgReadChunkHeader(chunk.data(), chunk.size(), header);
+    header.nScans = header.payloadSize + 1;
+    memcpy(&chunk[0], &header, sizeof(header));
+    bool corrupt = !urgReadChunkHeader(chunk.data(), chunk.size(), header);
+
+    bool ok = valid && corrupt;
+    cout << "chunk_header_check valid_read=" << valid << " corrupt_rejected=" << corrupt << " ok=" << ok << endl;
+    if (!ok) nFailedChecks++;
+}
+
+// ---------------------------------------------------------------------
+
+// a chunk as version 1 recordings coded it (a zigzag delta for every beam,
+// no runs) still reads back: two scans of three beams
+static void benchOldChunk() {
+
+    const uint8_t payload[] = { 5, 20, 40, 60, 0xc8, 0x01, 2, 0, 1 };
+    urgChunkHeader header;
+    memcpy(header.magic, URG_CHUNK_MAGIC, 4);
+    header.nScans = 2;
+    header.payloadSize = sizeof(payload);
+    string chunk((const char*)&header, sizeof(header));
+    chunk.append((const char*)payload, sizeof(payload));
+
+    uint32_t times[2];
+    int32_t ranges[6];
+    int32_t expected[] = { 10, 20, 30, 11, 20, 29 };
+    bool decoded = urgDecodeChunk(chunk.data(), chunk.size(), 3, times, ranges, false);
+    bool matches = decoded && times[0] == 5 && times[1] == 105 && memcmp(ranges, expected, sizeof(expected)) == 0;
+
+    cout << "old_chunk_check decoded=" << decoded << " matches=" << matches << endl;
+    if (!matches) nFailedChecks++;
+}
+
+// ---------------------------------------------------------------------
+
+// a csv recording's sidecar index loads for the recording it was made for, and
+// not for one of the same size whose first or last scan has since changed, nor
+// when the sidecar itself is damaged
+static void benchScanIndex(const benchSettings& settings) {
+
+    vector<string> lines = makeCsvLines(200, settings.nBeams);
+    string recording;
+    for (size_t i = 0; i < lines.size(); i++) recording += lines[i] + "\n";
+
+    string indexFileName = "bench_index.idx";
+    urgScanIndex index;
+    index.build(recording.data(), recording.size(), NULL);
+    bool saved = index.save(indexFileName, recording.data(), recording.size());
+    bool loaded = index.load(indexFileName, recording.data(), recording.size()) && index.size() == lines.size();
+
+    string firstChanged = recording;
+    firstChanged[0] = (firstChanged[0] == '1') ? '2' : '1';
+    string lastChanged = recording;
+    lastChanged[lastChanged.size() - 2] = (lastChanged[lastChanged.size() - 2] == '1') ? '2' : '1';
+    bool stale = !index.load(indexFileName, firstChanged.data(), firstChanged.size()) && !index.load(indexFileName, lastChanged.data(), lastChanged.size());
+
+    // a damaged sidecar for the right recording: a scan count far past its
+    // length, then an offset past the end of the recording
+    bool damaged = true;
+    uint64_t badValues[] = { (uint64_t)1 << 60, recording.size() };
+    size_t badPositions[] = { 24, 32 };
+    for (int i = 0; i < 2; i++) {
+        index.save(indexFileName, recording.data(), recording.size());
+        fstream file(indexFileName.c_str(), ios::in | ios::out | ios::binary);
+        file.seekp(badPositions[i]);
+        file.write((const char*)&badValues[i], sizeof(badValues[i]));
+        file.close();
+        damaged = damaged && !index.load(indexFileName, recording.data(), recording.size()) && index.size() == 0;
+    }
+    ofFile::removeFile(indexFileName);
+
+    bool ok = saved && loaded && stale && damaged;
+    cout << "scan_index_check loaded=" << loaded << " stale_rejected=" << stale << " damaged_rejected=" << damaged << " ok=" << ok << endl;
+    if (!ok) nFailedChecks++;
+}
+
+// ---------------------------------------------------------------------
+
+// a scan waiting in the receive queue, as urgScanReceiver keeps it
+struct benchReceivedScan {
+    uint64_t arrival;
+    vector<int32_t> ranges;
+    vector<float> angles;
+};
+
+// handing scans from the receive thread to the main thread through the
+// lock-free queue: one thread fills slots as fast as it can while the other
+// converts each scan as it takes it; every scan has to come through, in order
+static void benchReceive(const benchScans& scans, const benchSettings& settings) {
+
+    int nScans = settings.nScans;
+    int nBeams = settings.nBeams;
+
+    urgSpscQueue<benchReceivedScan> queue;
+    queue.setup(64);
+    for (size_t i = 0; i < queue.getCapacity(); i++) {
+        queue.getSlot(i).ranges.reserve(nBeams);
+        queue.getSlot(i).angles.reserve(nBeams);
+    }
+    urgBeamTable beamTable;
+    vector<float> xy(2 * nBeams);
+
+    benchRun run = beginBench("receive_handoff");
+    std::thread receiveThread([&]() {
+        for (int s = 0; s < nScans; s++) {
+            benchReceivedScan* slot;
+            while ((slot = queue.back()) == NULL) std::this_thread::yield();
+            slot->arrival = s;
+            slot->ranges.assign(&scans.ranges[(size_t)s * nBeams], &scans.ranges[(size_t)(s + 1) * nBeams]);
+            slot->angles.assign(scans.angles.begin(), scans.angles.end());
+            queue.push();
+        }
+    });
+
+    bool inOrder = true;
+    for (int s = 0; s < nScans; s++) {
+        benchReceivedScan* scan;
+        while ((scan = queue.front()) == NULL) std::this_thread::yield();
+        inOrder = inOrder && scan->arrival == (uint64_t)s && memcmp(scan->ranges.data(), &scans.ranges[(size_t)s * nBeams], nBeams * sizeof(int32_t)) == 0;
+        beamTable.convert(scan->ranges.data(), scan->angles.data(), nBeams, xy.data());
+        queue.pop();
+    }
+    receiveThread.join();
+    endBench(run, nScans, (size_t)nScans * nBeams);
+
+    cout << "receive_check scans=" << nScans << " in_order=" << inOrder << endl;
+    if (!inOrder) nFailedChecks++;
+}
+
+// ---------------------------------------------------------------------
+
+// the background model on a static room with a person walking across it
+// after the model has learned the room: the person's beams have to be
+// picked out and few others, and recording only the foreground has to make
+// the compressed recording much smaller
+static void benchBackground(const benchSettings& settings) {
+
+    int nScans = settings.nScans;
+    int nBeams = settings.nBeams;
+    int learnScans = 100;
+    int personBeams = 30;
+
+    ofSeedRandom(settings.seed);
+    vector<int32_t> ranges((size_t)nScans * nBeams);
+    vector<uint8_t> person((size_t)nScans * nBeams, 0);
+    for (int s = 0; s < nScans; s++) {
+        int first = (s - learnScans) % (nBeams + personBeams) - personBeams;
+        for (int i = 0; i < nBeams; i++) {
+            float angle = ofDegToRad(-120 + 240. * i / (nBeams - 1));
+            float r = 2500 + 1000 * sin(angle * 3) + ofRandom(-settings.noise, settings.noise);
+            bool inside = s >= learnScans && i >= first && i < first + personBeams;
+            if (inside) r = 1200 + ofRandom(-settings.noise, settings.noise);
+
+            // some beams never return
+            if (i % 50 == 0) {
+                r = 0;
+                inside = false;
+            }
+            ranges[(size_t)s * nBeams + i] = r;
+            person[(size_t)s * nBeams + i] = inside;
+        }
+    }
+
+    urgBackgroundModel model;
+    model.setup(5, 100, 4);
+    model.learnScans = learnScans;
+    vector<uint8_t> foreground((size_t)nScans * nBeams);
+    benchRun run = beginBench("background_model");
+    for (int s = 0; s < nScans; s++) {
+        model.apply(&ranges[(size_t)s * nBeams], nBeams, &foreground[(size_t)s * nBeams]);
+    }
+    double seconds = now() - run.start;
+    endBench(run, nScans, (size_t)nScans * nBeams);
+
+    // found and wrongly found beams, once the model has learned
+    size_t nPerson = 0, nFound = 0, nWrong = 0, nOther = 0;
+    for (size_t b = (size_t)learnScans * nBeams; b < foreground.size(); b++) {
+        nPerson += person[b];
+        nFound += person[b] && foreground[b];
+        nOther += !person[b];
+        nWrong += !person[b] && foreground[b];
+    }
+    double found = nPerson > 0 ? (double)nFound / nPerson : 1;
+    double wrong = nOther > 0 ? (double)nWrong / nOther : 0;
+
+    // the compressed recording, whole and of the foreground only
+    size_t wholeBytes = 0, foregroundBytes = 0;
+    urgChunkEncoder whole, foregroundOnly;
+    whole.setup(nBeams);
+    foregroundOnly.setup(nBeams);
+    vector<int32_t> kept(nBeams);
+    for (int s = 0; s < nScans; s++) {
+        const int32_t* scan = &ranges[(size_t)s * nBeams];
+        for (int i = 0; i < nBeams; i++) kept[i] = scan[i] * foreground[(size_t)s * nBeams + i];
+        if (whole.add(s * 100, scan, nBeams)) wholeBytes += whole.getChunk().size();
+        if (foregroundOnly.add(s * 100, kept.data(), nBeams)) foregroundBytes += foregroundOnly.getChunk().size();
+    }
+    if (whole.finish()) wholeBytes += whole.getChunk().size();
+    if (foregroundOnly.finish()) foregroundBytes += foregroundOnly.getChunk().size();
+    double ratio = foregroundBytes > 0 ? (double)wholeBytes / foregroundBytes : 0;
+
+    // how many sensors one core keeps up with, at the URG-04LX's 10 Hz
+    double sensorsPerCore = seconds > 0 ? nScans / seconds / 10 : 0;
+    bool ok = found >= 0.99 && wrong < 0.001 && ratio > 5;
+    cout << "background_check found=" << found << " false_positive_rate=" << wrong
+         << " compressed_ratio=" << ratio << " sensors_per_core_at_10hz=" << sensorsPerCore
+         << " ok=" << ok << endl;
+    if (!ok) nFailedChecks++;
+}
+
+// ---------------------------------------------------------------------
+
+// tracking people walking back and forth through a room, each in a part of
+// it of their own, through the background model and the blob tracker as
+// urg_record runs them; each scan has to take under a millisecond, and each
+// person has to keep one id and be reported near where they are
+static void benchTracker(const benchSettings& settings) {
+
+    int nScans = settings.nScans;
+    int nBeams = settings.nBeams;
+    int learnScans = 100;
+    const int nPeople = 4;
+    float personRadius = 200;
+
+    vector<float> angles(nBeams);
+    for (int i = 0; i < nBeams; i++) angles[i] = ofDegToRad(-120 + 240. * i / (nBeams - 1));
+    urgBeamTable beamTable;
+    urgBackgroundModel model;
+    model.setup(5, 100, 4);
+    model.learnScans = learnScans;
+    urgBlobTracker tracker;
+    tracker.setup();
+
+    ofSeedRandom(settings.seed);
+    vector<int32_t> ranges(nBeams);
+    vector<float> xy(2 * nBeams);
+    vector<uint8_t> foreground(nBeams);
+    vector<double> times;
+    times.reserve(nScans);
+    ofVec2f people[nPeople];
+    map<int, int> idPerson;
+    int nIdSwitches = 0;
+    unsigned long nExpected = 0, nReportedNear = 0;
+    size_t allocations = 0;
+
+    for (int s = 0; s < nScans; s++) {
+
+        // person p walks back and forth across a sector of the room at 1 m/s
+        bool present = s >= learnScans;
+        for (int p = 0; p < nPeople; p++) {
+            float distance = 1200 + 300 * p;
+            float angle = ofDegToRad(-85 + 55 * p + 25 * sin((s - learnScans) * 0.1 / (distance / 1000.)));
+            people[p].set(distance * cos(angle), distance * sin(angle));
+        }
+
+        // each beam returns from the nearest person it hits, or the walls
+        for (int i = 0; i < nBeams; i++) {
+            float c = cos(angles[i]), sn = sin(angles[i]);
+            float r = 3500 + 500 * sin(angles[i] * 3);
+            for (int p = 0; present && p < nPeople; p++) {
+                float along = people[p].x * c + people[p].y * sn;
+                float across = people[p].x * sn - people[p].y * c;
+                if (along > 0 && fabs(across) < personRadius) r = min(r, along - sqrt(personRadius * personRadius - across * across));
+            }
+            ranges[i] = (i % 50 == 0) ? 0 : r + ofRandom(-settings.noise, settings.noise);
+        }
+
+        size_t allocationsBefore = nAllocations;
+        double start = now();
+        beamTable.convert(ranges.data(), angles.data(), nBeams, xy.data());
+        model.apply(ranges.data(), nBeams, foreground.data());
+        tracker.update(s * 100, ranges.data(), xy.data(), nBeams, foreground.data());
+        times.push_back(now() - start);
+        if (s >= learnScans + 10) allocations += nAllocations - allocationsBefore;
+
+        // once everyone's had time to be confirmed, each should be reported nearby by one id
+        if (s < learnScans + tracker.confirmScans + 5) continue;
+        const vector<urgTrack>& tracks = tracker.getTracks();
+        for (int p = 0; p < nPeople; p++) {
+            nExpected++;
+            for (size_t t = 0; t < tracks.size(); t++) {
+                if (!tracker.isReported(tracks[t]) || tracks[t].position.distance(people[p]) > personRadius * 1.5) continue;
+                nReportedNear++;
+                if (idPerson.count(tracks[t].id) == 0) idPerson[tracks[t].id] = p;
+                else if (idPerson[tracks[t].id] != p) nIdSwitches++;
+                break;
+            }
+        }
+    }
+
+    vector<double> sorted = times;
+    sort(sorted.begin(), sorted.end());
+    double total = 0;
+    for (size_t i = 0; i < times.size(); i++) total += times[i];
+    double meanUs = total / times.size() * 1e6;
+    double p99Us = sorted[sorted.size() * 99 / 100] * 1e6;
+    double maxUs = sorted.back() * 1e6;
+
+    double reported = nExpected > 0 ? (double)nReportedNear / nExpected : 0;
+    bool ok = p99Us < 1000 && reported >= 0.99 && (int)idPerson.size() == nPeople && nIdSwitches == 0;
+    cout << "tracker scans=" << nScans << " people=" << nPeople
+         << " mean_us=" << meanUs << " p99_us=" << p99Us << " max_us=" << maxUs
+         << " allocs_per_scan=" << (double)allocations / max(nScans - learnScans - 10, 1) << endl;
+    cout << "tracker_check reported_near=" << reported << " ids=" << idPerson.size()
+         << " id_switches=" << nIdSwitches << " ok=" << ok << endl;
+    if (!ok) nFailedChecks++;
+}
+
+// ---------------------------------------------------------------------
+
+// building a level of detail octree, and choosing what to draw from it for
+// views like the display's at several zooms and rotations; every choice has
+// to stay within its point budget
+static void benchOctree(const ofMesh& mesh, string label) {
+
+    size_t nPoints = mesh.getNumVertices();
+
+    urgOctree octree;
+    benchRun run = beginBench("octree_build_" + label);
+    octree.build(mesh);
+    endBench(run, 0, nPoints);
+
+    // the display's screen: a 1024 x 768 window seen by openFrameworks' default camera
+    float width = 1024, height = 768;
+    float distance = (height / 2) / tan(ofDegToRad(30));
+    ofMatrix4x4 view = ofMatrix4x4::newTranslationMatrix(-width / 2, -height / 2, -distance);
+    ofMatrix4x4 projection = ofMatrix4x4::newPerspectiveMatrix(60, width / height, distance / 10, distance * 10);
+
+    float scales[] = { 0.02, 0.2, 1, 5 };
+    float rotations[] = { 0, 90 };
+    size_t budgets[] = { 100000, 1000000 };
+    vector<urgOctreeRange> ranges;
+
+    for (int s = 0; s < 4; s++) {
+        for (int r = 0; r < 2; r++) {
+            for (int b = 0; b < 2; b++) {
+
+                // scaled and rotated about the middle of the window, as drawSphericalMesh does
+                ofMatrix4x4 model = ofMatrix4x4::newScaleMatrix(scales[s], scales[s], scales[s])
+                                  * ofMatrix4x4::newRotationMatrix(rotations[r], 0, 1, 0)
+                                  * ofMatrix4x4::newTranslationMatrix(width / 2, height / 2, 0);
+
+                double start = now();
+                size_t nSelected = octree.select(model * view * projection, width, height, budgets[b], 1.5, ranges);
+                double seconds = now() - start;
+
+                // a selection over its budget is a failure
+                size_t nInRanges = 0;
+                for (size_t i = 0; i < ranges.size(); i++) nInRanges += ranges[i].count;
+                bool withinBudget = (nSelected <= budgets[b] && nInRanges == nSelected);
+                if (!withinBudget) nFailedChecks++;
+
+                cout << "octree_select_" << label
+                     << " scale=" << scales[s] << " rotation=" << rotations[r]
+                     << " budget=" << budgets[b] << " points=" << nPoints
+                     << " selected=" << nSelected << " ranges=" << ranges.size()
+                     << " select_us=" << seconds * 1e6
+                     << " within_budget=" << withinBudget << endl;
+            }
+        }
+    }
+}
+
+// ---------------------------------------------------------------------
+
+// compare the playback window's points with a fill of the same scans; the
+// window's depths are offset, so depths are compared from each mesh's first point
+static bool sameLinearPoints(const ofMesh& window, const ofMesh& fill) {
+
+    const vector<ofVec3f>& a = window.getVertices();
+    const vector<ofVec3f>& b = fill.getVertices();
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].x != b[i].x || a[i].y != b[i].y) return false;
+        if (fabs((a[i].z - a[0].z) - (b[i].z - b[0].z)) > 0.01) return false;
+    }
+    return true;
+}
+
+// playing a recording through to its end and back to its start, a frame at
+// a time with a little time between frames (as drawing would take) for the
+// prefetch thread; the window has to stay within its size, and once it's
+// caught up it has to hold the same points as a fill of its scans
+static void benchPlayback(string fileName, string label, const benchSettings& settings) {
+
+    int windowScans = 300;
+    float frameSeconds = 1 / 60.;
+
+    urgDisplay urg;
+    urg.loadLinearData(fileName);
+    urg.fillLinearMesh(0, -1, 300, 0, settings.nBeams, false, 265, ofColor(255));
+    urg.linearPlaybackScans = windowScans;
+    urg.linearPlayback = true;
+
+    unsigned long nScans = urg.linearRecording.getNumScans();
+    double startTime = urg.linearRecording.getScanTime(0);
+    double endTime = urg.linearRecording.getScanTime(nScans - 1);
+    bool bounded = true;
+    bool matches = true;
+
+    float speeds[] = { 16, -16 };
+    string names[] = { "forward", "reverse" };
+    for (int d = 0; d < 2; d++) {
+
+        urg.linearPlaybackSpeed = speeds[d];
+        unsigned long nFrames = 0, nBehind = 0;
+        double seconds = 0, maxSeconds = 0;
+        size_t maxPoints = 0;
+        while (nFrames == 0 || (speeds[d] > 0 ? urg.linearPlayhead < endTime : urg.linearPlayhead > startTime)) {
+
+            double start = now();
+            urg.updateLinearPlayback(frameSeconds);
+            double frame = now() - start;
+            seconds += frame;
+            maxSeconds = max(maxSeconds, frame);
+            nFrames++;
+
+            // the window holds fewer scans than it should when the prefetch thread is behind
+            unsigned long end = urg.linearRecording.findScan(urg.linearPlayhead);
+            while (end < nScans && urg.linearRecording.getScanTime(end) <= urg.linearPlayhead) end++;
+            if (urg.nLinearScans < min(end, (unsigned long)windowScans)) nBehind++;
+
+            maxPoints = max(maxPoints, urg.linearMesh.getNumVertices());
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (maxPoints > (size_t)windowScans * settings.nBeams) bounded = false;
+        cout << "playback_" << names[d] << "_" << label
+             << " speed=" << speeds[d]
+             << " frames=" << nFrames
+             << " update_us_mean=" << seconds / nFrames * 1e6
+             << " update_us_max=" << maxSeconds * 1e6
+             << " frames_behind=" << nBehind
+             << " max_window_points=" << maxPoints
+             << " peak_rss_mb=" << peakRssMB() << endl;
+
+        // let the prefetch thread catch up, then compare with a fill of the window's scans
+        for (int i = 0; i < 1000 && urg.nLinearScans < (unsigned long)min((unsigned long)windowScans, nScans); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            urg.updateLinearPlayback(0);
+        }
+        unsigned long end = urg.linearRecording.findScan(urg.linearPlayhead);
+        while (end < nScans && urg.linearRecording.getScanTime(end) <= urg.linearPlayhead) end++;
+        unsigned long begin = end > (unsigned long)windowScans ? end - windowScans : 0;
+        urgDisplay fill;
+        fill.loadLinearData(fileName);
+        fill.fillLinearMesh(begin, end + 1, 300, 0, settings.nBeams, false, 265, ofColor(255));
+        if (!sameLinearPoints(urg.linearMesh, fill.linearMesh)) matches = false;
+    }
+
+    cout << "playback_" << label << "_check window_scans=" << windowScans << " bounded=" << bounded << " matches_fill=" << matches << endl;
+    if (!bounded || !matches) nFailedChecks++;
+}
+
+// ---------------------------------------------------------------------
+
+// outlier removal on a grid with planted outliers: a wall seen by a rotating
+// sensor, with some beams pulled halfway back towards the sensor (as mixed
+// pixels are) and some holes; the planted ones have to be found and few others
+static void benchOutliers(const benchSettings& settings) {
+
+    int nRows = settings.nScans;
+    int nColumns = settings.nBeams;
+    vector<ofVec3f> points;
+    vector<int32_t> cells((size_t)nRows * nColumns, -1);
+    vector<uint8_t> planted;
+    ofSeedRandom(settings.seed);
+    for (int r = 0; r < nRows; r++) {
+        float rotation = ofDegToRad(180. * r / nRows);
+        for (int c = 0; c < nColumns; c++) {
+            if (ofRandom(0, 1) < 0.02) continue;
+            float angle = ofDegToRad(-120 + 240. * c / (nColumns - 1));
+            float range = 3000 + 500 * sin(angle * 2) + ofRandom(-settings.noise, settings.noise);
+            bool outlier = ofRandom(0, 1) < 0.01;
+            if (outlier) range *= ofRandom(0.4, 0.7);
+            float x = range * cos(angle);
+            cells[(size_t)r * nColumns + c] = points.size();
+            points.push_back(ofVec3f(x * cos(rotation), range * sin(angle), -x * sin(rotation)));
+            planted.push_back(outlier);
+        }
+    }
+
+    vector<uint8_t> outliers;
+    benchRun run = beginBench("outliers_grid");
+    size_t nOutliers = urgFindOutliers(points.data(), points.size(), cells.data(), nRows, nColumns, 1, 2, outliers);
+    endBench(run, nRows, points.size());
+
+    size_t nPlanted = 0, nFound = 0;
+    for (size_t p = 0; p < points.size(); p++) {
+        nPlanted += planted[p];
+        nFound += planted[p] && outliers[p];
+    }
+    double found = nPlanted > 0 ? (double)nFound / nPlanted : 1;
+    double falseRate = (double)(nOutliers - nFound) / (points.size() - nPlanted);
+    bool ok = found >= 0.99 && falseRate < 0.02;
+    cout << "outliers_grid_check planted=" << nPlanted << " found=" << found
+         << " false_positive_rate=" << falseRate << " ok=" << ok << endl;
+    if (!ok) nFailedChecks++;
+}
+
+// ---------------------------------------------------------------------
+
+// parsing every scan of a recording once, and checking the cache holds each
+// scan exactly as the recording reads it
+static void benchScanCache(string fileName, string label, const benchSettings& settings) {
+
+    urgRecording recording;
+    recording.load(fileName);
+    urgScanCache cache;
+    benchRun run = beginBench("scan_cache_" + label);
+    cache.build(recording);
+    endBench(run, cache.getNumScans(), (size_t)cache.getNumScans() * cache.getNumBeams());
+
+    bool ok = cache.getNumScans() == recording.getNumScans() && cache.getNumScans() > 0;
+    urgScan read, cached;
+    for (unsigned long s = 0; ok && s < cache.getNumScans(); s++) {
+        bool valid = recording.readScan(s, read, false) != URG_PARSE_MALFORMED;
+        ok = cache.getScan(s, cached) == valid && cached.time == read.time && cached.ranges == read.ranges && cached.points.size() == read.points.size();
+        for (size_t i = 0; ok && i < read.points.size(); i++) {
+            ok = cached.points[i].x == read.points[i].x && cached.points[i].y == read.points[i].y && cache.getX(s)[i] == read.points[i].x && cache.getY(s)[i] == read.points[i].y;
+        }
+    }
+    cout << "scan_cache_" << label << "_check bytes_mb=" << urgScanCache::getBytes(recording) / 1048576.
+         << " matches_recording=" << ok << endl;
+    if (!ok) nFailedChecks++;
+}
+
+// ---------------------------------------------------------------------
+
+// loading, filling and exporting a recording in the display
+static void benchDisplay(string fileName, string label, const benchSettings& settings) {
+
+    size_t nPoints = (size_t)settings.nScans * settings.nBeams;
+
+    // load without a scan index, so it's built
+    ofFile::removeFile(fileName + ".idx");
+    urgDisplay urg;
+    benchRun run = beginBench("load_linear_" + label);
+    urg.loadLinearData(fileName);
+    endBench(run, settings.nScans, nPoints);
+
+    run = beginBench("fill_linear_" + label);
+    urg.fillLinearMesh(0, -1, 300, 0, settings.nBeams, false, 265, ofColor(255));
+    endBench(run, urg.nLinearScans, urg.linearMesh.getNumVertices());
+
+    // filling from the parsed scans has to place every point as parsing them does
+    urgDisplay parsing;
+    parsing.linearScanCacheMB = 0;
+    parsing.loadLinearData(fileName);
+    run = beginBench("fill_linear_" + label + "_unparsed");
+    parsing.fillLinearMesh(0, -1, 300, 0, settings.nBeams, false, 265, ofColor(255));
+    endBench(run, parsing.nLinearScans, parsing.linearMesh.getNumVertices());
+    const vector<ofVec3f>& filled = urg.linearMesh.getVertices();
+    const vector<ofVec3f>& parsed = parsing.linearMesh.getVertices();
+    bool matches = filled.size() == parsed.size() && memcmp(filled.data(), parsed.data(), filled.size() * sizeof(ofVec3f)) == 0;
+    
+    // and so does moving the window over them
+    urg.updateLinearMesh(settings.nScans / 4, settings.nScans / 2, 300, 10, settings.nBeams - 10, true, 500, ofColor(255));
+    parsing.updateLinearMesh(settings.nScans / 4, settings.nScans / 2, 300, 10, settings.nBeams - 10, true, 500, ofColor(255));
+    matches = matches && filled.size() == parsed.size() && memcmp(filled.data(), parsed.data(), filled.size() * sizeof(ofVec3f)) == 0;
+    cout << "fill_linear_" << label << "_check points=" << filled.size() << " matches_unparsed=" << matches << endl;
+    if (!matches) nFailedChecks++;
+    urg.fillLinearMesh(0, -1, 300, 0, settings.nBeams, false, 265, ofColor(255));
+
+    // the same recording as if taken by the rotating lidar (parsed once, as it's loaded)
+    run = beginBench("load_spherical_" + label);
+    urg.loadSphericalData(fileName);
+    endBench(run, settings.nScans, nPoints);
+    float nPeriods[] = { 0.25, 0.5, 1 };
+    for (int p = 0; p < 3; p++) {
+        run = beginBench("fill_spherical_" + label + "_periods_" + ofToString(nPeriods[p]));
+        urg.fillSphericalMesh(225./64., 180, 0, nPeriods[p], 0, settings.nBeams, true, 265, 0, ofColor(255), true);
+        endBench(run, urg.nSphericalScans, urg.sphericalMesh.getNumVertices());
+    }
+    
+    // a calibration sweep: filling again with a new speed and alignment each time
+    int nRefills = 10;
+    unsigned long nRefilledScans = 0;
+    size_t nRefilledPoints = 0;
+    run = beginBench("refill_spherical_" + label);
+    for (int i = 0; i < nRefills; i++) {
+        urg.fillSphericalMesh(225./64. * (1 + 0.01 * i), 180, 0, 1, 0, settings.nBeams, i % 2 == 0, 265, 0.5 * i, ofColor(255), true);
+        nRefilledScans += urg.nSphericalScans;
+        nRefilledPoints += urg.sphericalMesh.getNumVertices();
+    }
+    endBench(run, nRefilledScans, nRefilledPoints);
+    cout << "refill_spherical_" << label << "_per_fill ms=" << (now() - run.start) / nRefills * 1000 << endl;
+
+    // a recording too long to hold parsed is read at every fill, into the same points
+    urgDisplay sphericalParsing;
+    sphericalParsing.sphericalScanCacheMB = 0;
+    sphericalParsing.loadSphericalData(fileName);
+    run = beginBench("fill_spherical_unparsed_" + label);
+    sphericalParsing.fillSphericalMesh(225./64. * 1.09, 180, 0, 1, 0, settings.nBeams, false, 265, 4.5, ofColor(255), true);
+    endBench(run, sphericalParsing.nSphericalScans, sphericalParsing.sphericalMesh.getNumVertices());
+    const vector<ofVec3f>& cached = urg.sphericalMesh.getVertices();
+    const vector<ofVec3f>& unparsed = sphericalParsing.sphericalMesh.getVertices();
+    bool sphericalMatches = cached.size() == unparsed.size();
+    for (size_t i = 0; sphericalMatches && i < cached.size(); i++) {
+        sphericalMatches = cached[i].x == unparsed[i].x && cached[i].y == unparsed[i].y && cached[i].z == unparsed[i].z;
+    }
+    cout << "fill_spherical_" << label << "_check points=" << cached.size() << " matches_unparsed=" << sphericalMatches << endl;
+    if (!sphericalMatches) nFailedChecks++;
+
+    benchOctree(urg.sphericalMesh, "spherical_" + label);
+
+    // downsampling the last spherical mesh
+    ofMesh downsampled;
+    run = beginBench("voxel_spherical_" + label);
+    size_t nKept = urgVoxelDownsample(urg.sphericalMesh, downsampled, 20);
+    endBench(run, urg.nSphericalScans, urg.sphericalMesh.getNumVertices());
+    cout << "voxel_spherical_" << label << "_reduction cell_mm=20 kept=" << nKept
+         << " reduction=" << (nKept > 0 ? (double)urg.sphericalMesh.getNumVertices() / nKept : 0) << endl;
+
+    // removing outliers from it (last, as it changes the mesh)
+    size_t nFilled = urg.sphericalMesh.getNumVertices();
+    run = beginBench("outliers_spherical_" + label);
+    size_t nOutliers = urg.removeSphericalOutliers(2, 1);
+    endBench(run, urg.nSphericalScans, nFilled);
+    cout << "outliers_spherical_" << label << "_removed outliers=" << nOutliers
+         << " fraction=" << (nFilled > 0 ? (double)nOutliers / nFilled : 0) << endl;
+
+    // export the linear mesh in each format
+    const vector<ofVec3f>& points = urg.linearMesh.getVertices();
+    urgExportType types[] = { URG_EXPORT_PLY_BINARY, URG_EXPORT_PLY_ASCII, URG_EXPORT_RAW };
+    string typeNames[] = { "ply_binary", "ply_ascii", "raw" };
+    for (int t = 0; t < 3; t++) {
+        string exportFileName = "bench_export." + urgExportExtension(types[t]);
+        run = beginBench("export_" + typeNames[t] + "_" + label);
+        urgExportPoints(exportFileName, points.data(), points.size(), types[t]);
+        endBench(run, urg.nLinearScans, points.size());
+        ofFile::removeFile(exportFileName);
+    }
+}
+
+//========================================================================
+int main(int argc, char** argv) {
+
+    benchSettings settings;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "--scans") settings.nScans = max(1, ofToInt(argv[i + 1]));
+        else if (arg == "--beams") settings.nBeams = max(2, ofToInt(argv[i + 1]));
+        else if (arg == "--noise") settings.noise = ofToFloat(argv[i + 1]);
+        else if (arg == "--seed") settings.seed = ofToInt(argv[i + 1]);
+        else {
+            cerr << "urg_bench: unknown option " << arg << endl;
+            return 1;
+        }
+    }
+
+    // the recordings only tell us so much
+    ofSetLogLevel(OF_LOG_WARNING);
+
+    cout << "settings scans=" << settings.nScans << " beams=" << settings.nBeams
+         << " noise=" << settings.noise << " seed=" << settings.seed << endl;
+
+    benchScanParser(settings.nScans, settings.nBeams);
+
+    benchScans scans = makeScans(settings);
+    benchReceive(scans, settings);
+    benchBackground(settings);
+    benchTracker(settings);
+    string csvFileName = "bench_recording.csv";
+    string binaryFileName = string("bench_recording.") + URG_BINARY_EXTENSION;
+    string compressedFileName = string("bench_recording_compressed.") + URG_BINARY_EXTENSION;
+    string polarFileName = string("bench_recording_polar.") + URG_BINARY_EXTENSION;
+    benchRecorder(scans, settings, csvFileName, binaryFileName, compressedFileName, polarFileName);
+    string fileNames[] = { csvFileName, binaryFileName, compressedFileName, polarFileName };
+    benchSegments(scans, settings, fileNames);
+    benchRanges(binaryFileName, compressedFileName, "compressed");
+    benchChunkHeader(scans, settings);
+    benchOldChunk();
+    benchScanIndex(settings);
+    benchRanges(binaryFileName, polarFileName, "polar");
+
+    benchOutliers(settings);
+    benchScanCache(csvFileName, "csv", settings);
+    benchDisplay(csvFileName, "csv", settings);
+    benchScanCache(binaryFileName, "binary", settings);
+    benchDisplay(binaryFileName, "binary", settings);
+    benchScanCache(compressedFileName, "compressed", settings);
+    benchDisplay(compressedFileName, "compressed", settings);
+    benchScanCache(polarFileName, "polar", settings);
+    benchDisplay(polarFileName, "polar", settings);
+    benchPlayback(csvFileName, "csv", settings);
+    benchPlayback(polarFileName, "polar", settings);
+
+    ofFile::removeFile(csvFileName);
+    ofFile::removeFile(csvFileName + ".idx");
+    ofFile::removeFile(binaryFileName);
+    ofFile::removeFile(binaryFileName + ".idx");
+    ofFile::removeFile(compressedFileName);
+    ofFile::removeFile(polarFileName);
+
+    if (nFailedChecks > 0) {
+        cerr << "urg_bench: " << nFailedChecks << " checks failed" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,202 @@
+//
+//  urgCodec.cpp
+//  urg_common
+//
+//  Compressed scan records for the URG_LAYOUT_DELTA_RANGES layout. The
+//  range (integer mm) of each beam changes little from one scan to the
+//  next, so each beam is stored as the difference from its range in the
+//  previous scan, zigzag and varint coded (one byte for most beams).
+//  Scans are grouped into chunks that each start from zero, so any chunk
+//  can be decoded on its own (and chunks can be decoded in parallel).
+//  Runs of beams that didn't change are coded as one varint each (from
+//  version 2 recordings on).
+//
+
+#include "urgCodec.h"
+
+// small magnitudes of either sign to small unsigned numbers: 0, -1, 1, -2 ... -> 0, 1, 2, 3 ...
+static inline uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+// 7 bits per byte, low bits first, high bit set on every byte but the last
+// (a beam's coded delta takes 33 bits at most, so they're 64 bit)
+template<class T>
+static inline uint8_t* putVarint(uint8_t* out, T v) {
+    while (v >= 0x80) {
+        *out++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *out++ = (uint8_t)v;
+    return out;
+}
+
+template<class T>
+static inline bool getVarint(const uint8_t*& in, const uint8_t* end, T& v) {
+
+    // one byte is by far the most common case
+    if (in < end && *in < 0x80) {
+        v = *in++;
+        return true;
+    }
+    v = 0;
+    for (int shift = 0; shift < (int)sizeof(T) * 8 + 3 && in < end; shift += 7) {
+        uint8_t b = *in++;
+        v |= (T)(b & 0x7f) << shift;
+        if (b < 0x80) return true;
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------
+
+void urgChunkEncoder::setup(uint32_t nBeams, uint32_t scansPerChunk) {
+
+    beams = nBeams;
+    chunkScans = max(scansPerChunk, (uint32_t)1);
+    nScans = 0;
+    previous.assign(beams, 0);
+    deltas.resize(beams);
+    scratch.resize(5 * (beams + 1));
+    building.clear();
+    chunk.clear();
+}
+
+// ---------------------------------------------------------------------
+
+bool urgChunkEncoder::add(uint32_t time, const int32_t* ranges, uint32_t nBeams) {
+
+    // a new chunk starts from zero
+    if (nScans == 0) {
+        building.assign(sizeof(urgChunkHeader), '\0');
+        fill(previous.begin(), previous.end(), 0);
+    }
+
+    uint8_t* out = scratch.data();
+    out = putVarint(out, (nScans == 0) ? time : zigzag((int32_t)(time - lastTime)));
+    lastTime = time;
+
+    // deltas wrap around rather than overflow, so any range survives the round trip
+    uint32_t nKept = min(nBeams, beams);
+    int32_t* last = previous.data();
+    uint32_t* delta = deltas.data();
+    for (uint32_t i = 0; i < nKept; i++) {
+        delta[i] = zigzag((int32_t)((uint32_t)ranges[i] - (uint32_t)last[i]));
+        last[i] = ranges[i];
+    }
+    for (uint32_t i = nKept; i < beams; i++) {
+        delta[i] = zigzag((int32_t)(0u - (uint32_t)last[i]));
+        last[i] = 0;
+    }
+
+    // unchanged beams as runs, the rest one by one
+    for (uint32_t i = 0; i < beams;) {
+        if (delta[i] != 0) {
+            out = putVarint(out, (uint64_t)delta[i] << 1);
+            i++;
+            continue;
+        }
+        uint32_t run = 1;
+        while (i + run < beams && delta[i + run] == 0) run++;
+        out = putVarint(out, (run - 1) << 1 | 1);
+        i += run;
+    }
+    building.append((const char*)scratch.data(), out - scratch.data());
+    nScans++;
+
+    if (nScans < chunkScans) return false;
+    completeChunk();
+    return true;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgChunkEncoder::finish() {
+
+    if (nScans == 0) return false;
+    completeChunk();
+    return true;
+}
+
+// ---------------------------------------------------------------------
+
+void urgChunkEncoder::completeChunk() {
+
+    urgChunkHeader header;
+    memcpy(header.magic, URG_CHUNK_MAGIC, 4);
+    header.nScans = nScans;
+    header.payloadSize = building.size() - sizeof(urgChunkHeader);
+    memcpy(&building[0], &header, sizeof(header));
+
+    // (the buffers trade places, so neither is reallocated)
+    chunk.swap(building);
+    nScans = 0;
+}
+
+// ---------------------------------------------------------------------
+
+const string& urgChunkEncoder::getChunk() {
+    return chunk;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgReadChunkHeader(const char* data, size_t size, urgChunkHeader& header) {
+
+    if (size < sizeof(urgChunkHeader)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, URG_CHUNK_MAGIC, 4) != 0) return false;
+    if (header.payloadSize > size - sizeof(urgChunkHeader)) return false;
+
+    // every scan takes a byte at least, so a larger count is corrupt
+    // (and mustn't be trusted to size anything)
+    return header.nScans <= header.payloadSize;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgDecodeChunk(const char* data, size_t size, uint32_t nBeams, uint32_t* times, int32_t* ranges, bool runs) {
+
+    urgChunkHeader header;
+    if (!urgReadChunkHeader(data, size, header)) return false;
+
+    const uint8_t* in = (const uint8_t*)data + sizeof(urgChunkHeader);
+    const uint8_t* end = in + header.payloadSize;
+    uint32_t v;
+    uint64_t coded;
+
+    for (uint32_t s = 0; s < header.nScans; s++) {
+
+        if (!getVarint(in, end, v)) return false;
+        times[s] = (s == 0) ? v : times[s - 1] + (uint32_t)unzigzag(v);
+
+        // each beam from the same beam in the scan before (or zero, for the first scan)
+        int32_t* out = (ranges != NULL) ? ranges + (size_t)s * nBeams : NULL;
+        const int32_t* last = (out != NULL && s > 0) ? out - nBeams : NULL;
+        for (uint32_t i = 0; i < nBeams;) {
+            if (!getVarint(in, end, coded)) return false;
+
+            // older chunks hold nothing but deltas
+            if (!runs) {
+                if (coded > 0xffffffffULL) return false;
+                coded <<= 1;
+            }
+            if (coded & 1) {
+                uint64_t run = (coded >> 1) + 1;
+                if (run > nBeams - i) return false;
+                if (out == NULL) i += run;
+                else for (uint32_t r = 0; r < run; r++, i++) out[i] = (s == 0) ? 0 : last[i];
+            }
+            else {
+                if ((coded >> 1) > 0xffffffffULL) return false;
+                if (out != NULL) out[i] = (int32_t)(((s == 0) ? 0u : (uint32_t)last[i]) + (uint32_t)unzigzag((uint32_t)(coded >> 1)));
+                i++;
+            }
+        }
+    }
+    return in == end;
+}
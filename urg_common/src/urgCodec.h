@@ -0,0 +1,92 @@
+//
+//  urgCodec.h
+//  urg_common
+//
+//  Compressed scan records for the URG_LAYOUT_DELTA_RANGES layout. The
+//  range (integer mm) of each beam changes little from one scan to the
+//  next, so each beam is stored as the difference from its range in the
+//  previous scan, zigzag and varint coded (one byte for most beams).
+//  Scans are grouped into chunks that each start from zero, so any chunk
+//  can be decoded on its own (and chunks can be decoded in parallel).
+//
+//      chunk   | magic "URGC" | nScans (uint32) | payloadSize (uint32) | payload |
+//      payload | per scan: time, then the beams' deltas (varints)           |
+//
+//  The first time in a chunk is absolute (ms); later ones are deltas. Each
+//  beam's delta is coded as zigzag(delta) << 1, except that a run of beams
+//  that didn't change is one (runLength - 1) << 1 | 1, so the unchanged
+//  parts of a static scene (or the background blanked out of a foreground
+//  only recording) cost a byte per run instead of a byte per beam.
+//  Recordings before URG_CHUNK_RUNS_VERSION code every beam as zigzag(delta).
+//
+
+#ifndef __urg_common__urgCodec__
+#define __urg_common__urgCodec__
+
+#include "ofMain.h"
+
+#define URG_CHUNK_MAGIC "URGC"
+
+// first recording version (urgRecordingHeader::version) whose chunks code runs
+#define URG_CHUNK_RUNS_VERSION 2
+
+// scans per chunk (25 s of a 10 Hz sensor)
+#define URG_CHUNK_SCANS 256
+
+#pragma pack(push, 1)
+struct urgChunkHeader {
+    char magic[4];              // URG_CHUNK_MAGIC
+    uint32_t nScans;            // scans in the chunk
+    uint32_t payloadSize;       // bytes after this header
+};
+#pragma pack(pop)
+
+// encodes scans into chunks as they arrive
+class urgChunkEncoder {
+
+public:
+
+    // scans of nBeams beams, scansPerChunk to a chunk (clears any chunk in progress)
+    void setup(uint32_t nBeams, uint32_t scansPerChunk = URG_CHUNK_SCANS);
+
+    // add a scan; beams past the encoder's beam count are dropped and missing
+    // beams are stored as 0 (no return)
+    // returns true when this completes a chunk, which getChunk() then holds
+    bool add(uint32_t time, const int32_t* ranges, uint32_t nBeams);
+
+    // complete the chunk in progress; returns false if it has no scans
+    bool finish();
+
+    // the last completed chunk, header included (valid until the next add() or finish())
+    const string& getChunk();
+
+private:
+
+    void completeChunk();
+
+    uint32_t beams = 0;
+    uint32_t chunkScans = URG_CHUNK_SCANS;
+
+    // scans in the chunk being built, and the last scan's time and ranges
+    uint32_t nScans = 0;
+    uint32_t lastTime = 0;
+    vector<int32_t> previous;
+
+    string building;
+    string chunk;
+    vector<uint8_t> scratch;
+    vector<uint32_t> deltas;
+
+};
+
+// read the chunk header at data; returns false unless a whole chunk is there
+// whose scan count could fit in its payload
+bool urgReadChunkHeader(const char* data, size_t size, urgChunkHeader& header);
+
+// decode the chunk at data into times (nScans) and ranges (nScans * nBeams)
+// (both need room for the chunk header's nScans; ranges can be NULL to read
+// only the times); runs is false for the chunks of recordings from before
+// URG_CHUNK_RUNS_VERSION; returns false if the chunk is corrupt
+bool urgDecodeChunk(const char* data, size_t size, uint32_t nBeams, uint32_t* times, int32_t* ranges, bool runs = true);
+
+#endif /* defined(__urg_common__urgCodec__) */
@@ -0,0 +1,256 @@
+//
+//  urgFormat.cpp
+//  urg_common
+//
+//  Binary scan recording format shared by urg_record (writer) and
+//  urg_display (reader), plus a converter back to the CSV layout.
+//
+
+#include "urgFormat.h"
+#include "urgCodec.h"
+#include <chrono>
+
+// ---------------------------------------------------------------------
+
+urgRecordingHeader urgMakeHeader(uint32_t beamCount, float angularResolution, float startAngle, uint32_t sensorId, uint64_t startTime, uint32_t layout) {
+
+    urgRecordingHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, URG_BINARY_MAGIC, 4);
+    header.version = URG_BINARY_VERSION;
+    header.headerSize = sizeof(urgRecordingHeader) + (urgHasAngleTable(layout) ? sizeof(float) * beamCount : 0);
+    header.beamCount = beamCount;
+    header.sensorId = sensorId;
+    header.angularResolution = angularResolution;
+    header.startAngle = startAngle;
+    header.startTime = startTime;
+    header.layout = layout;
+    header.recordSize = (layout == URG_LAYOUT_CARTESIAN) ? urgCartesianRecordSize(beamCount) : (layout == URG_LAYOUT_POLAR) ? urgPolarRecordSize(beamCount) : 0;
+    return header;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgReadHeader(const char* data, size_t size, urgRecordingHeader& header) {
+
+    if (size < sizeof(urgRecordingHeader)) return false;
+    if (memcmp(data, URG_BINARY_MAGIC, 4) != 0) return false;
+
+    memcpy(&header, data, sizeof(urgRecordingHeader));
+
+    if (header.version > URG_BINARY_VERSION) {
+        ofLogError("urgFormat") << "recording version " << header.version << " is newer than this build supports (" << URG_BINARY_VERSION << ")";
+        return false;
+    }
+    if (header.headerSize < sizeof(urgRecordingHeader) || header.beamCount == 0) return false;
+    if (header.layout == URG_LAYOUT_CARTESIAN && header.recordSize != urgCartesianRecordSize(header.beamCount)) return false;
+    if (header.layout == URG_LAYOUT_POLAR && header.recordSize != urgPolarRecordSize(header.beamCount)) return false;
+    if (urgHasAngleTable(header.layout) && header.headerSize < sizeof(urgRecordingHeader) + sizeof(float) * header.beamCount) return false;
+
+    return true;
+}
+
+// ---------------------------------------------------------------------
+
+uint64_t urgUnixTimeMillis() {
+
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+// ---------------------------------------------------------------------
+
+uint64_t urgMakeSessionId() {
+
+    // the start time in the high bits keeps ids of different sessions apart,
+    // the random low bits those of sessions started at once
+    uint64_t id = (urgUnixTimeMillis() << 16) | ((uint64_t)ofRandom(65536) & 0xffff);
+    return id != 0 ? id : 1;
+}
+
+// ---------------------------------------------------------------------
+
+string urgSegmentFileName(string fileName, int segment) {
+
+    // the extension is whatever follows the last dot of the file's name
+    size_t slash = fileName.find_last_of("/\\");
+    size_t dot = fileName.find_last_of('.');
+    if (dot == string::npos || (slash != string::npos && dot < slash)) dot = fileName.size();
+
+    char number[16];
+    snprintf(number, sizeof(number), "%04d", segment);
+    return fileName.substr(0, dot) + URG_SEGMENT_TAG + number + fileName.substr(dot);
+}
+
+// ---------------------------------------------------------------------
+
+bool urgFindSegments(string fileName, vector<string>& segmentNames) {
+
+    segmentNames.clear();
+
+    // <name>_seg<digits>.<ext>
+    size_t slash = fileName.find_last_of("/\\");
+    size_t dot = fileName.find_last_of('.');
+    if (dot == string::npos || (slash != string::npos && dot < slash)) dot = fileName.size();
+    size_t digits = dot;
+    while (digits > 0 && isdigit(fileName[digits - 1])) digits--;
+    size_t tag = digits - min(digits, strlen(URG_SEGMENT_TAG));
+    if (dot - digits < 4 || fileName.compare(tag, strlen(URG_SEGMENT_TAG), URG_SEGMENT_TAG) != 0) return false;
+
+    string name = fileName.substr(0, tag) + fileName.substr(dot);
+    for (int i = 0; ; i++) {
+        string segmentName = urgSegmentFileName(name, i);
+        if (!ofFile(segmentName).exists()) break;
+        segmentNames.push_back(segmentName);
+    }
+
+    // a segment after a missing one is read on its own
+    if (find(segmentNames.begin(), segmentNames.end(), fileName) == segmentNames.end()) segmentNames.clear();
+    return !segmentNames.empty();
+}
+
+// ---------------------------------------------------------------------
+
+void urgAppendCsvScan(string& out, unsigned long time, const float* xy, uint32_t nBeams) {
+
+    // %g matches the default stream formatting used by ofToString(float)
+    char num[32];
+    int len = snprintf(num, sizeof(num), "%lu", time);
+    out.append(num, len);
+
+    for (uint32_t i = 0; i < 2 * nBeams; i++) {
+        out += ',';
+        len = snprintf(num, sizeof(num), "%g", xy[i]);
+        out.append(num, len);
+    }
+    out += '\n';
+}
+
+// ---------------------------------------------------------------------
+
+void urgRangesToCartesian(const int32_t* ranges, const float* cosines, const float* sines, uint32_t nBeams, float* xy) {
+
+    for (uint32_t i = 0; i < nBeams; i++) {
+        float range = ranges[i];
+        xy[2 * i] = range * cosines[i];
+        xy[2 * i + 1] = range * sines[i];
+    }
+}
+
+// ---------------------------------------------------------------------
+
+bool urgConvertToCsv(string binaryFileName, string csvFileName) {
+
+    ofFile in(binaryFileName, ofFile::ReadOnly, true);
+    if (!in.is_open()) {
+        ofLogError("urgFormat") << "could not open " << binaryFileName;
+        return false;
+    }
+
+    // read and check the header
+    char headerData[sizeof(urgRecordingHeader)];
+    urgRecordingHeader header;
+    in.read(headerData, sizeof(headerData));
+    if (!urgReadHeader(headerData, in.gcount(), header) || header.layout > URG_LAYOUT_POLAR) {
+        ofLogError("urgFormat") << binaryFileName << " is not a binary, compressed or polar recording";
+        return false;
+    }
+    if (in.getSize() < header.headerSize) {
+        ofLogError("urgFormat") << binaryFileName << " is shorter than its header";
+        return false;
+    }
+
+    // compressed and polar recordings hold ranges: they're converted with the beam angles that follow the header
+    uint32_t nBeams = header.beamCount;
+    vector<float> cosines, sines;
+    if (urgHasAngleTable(header.layout)) {
+        vector<float> angles(nBeams);
+        in.read((char*)angles.data(), sizeof(float) * nBeams);
+        cosines.resize(nBeams);
+        sines.resize(nBeams);
+        for (uint32_t i = 0; i < nBeams; i++) {
+            cosines[i] = cos(angles[i]);
+            sines[i] = sin(angles[i]);
+        }
+    }
+    in.seekg(header.headerSize);
+
+    ofFile out(csvFileName, ofFile::WriteOnly, true);
+
+    string text;
+    text.reserve(1 << 20);
+    unsigned long nScans = 0;
+
+    if (header.layout != URG_LAYOUT_DELTA_RANGES) {
+
+        // convert one record at a time, writing text out in large blocks
+        vector<char> record(header.recordSize);
+        vector<float> xy(2 * nBeams);
+        while (in.read(record.data(), header.recordSize)) {
+
+            uint32_t time;
+            memcpy(&time, record.data(), sizeof(time));
+            if (header.layout == URG_LAYOUT_POLAR) {
+                urgRangesToCartesian((const int32_t*)(record.data() + sizeof(time)), cosines.data(), sines.data(), nBeams, xy.data());
+                urgAppendCsvScan(text, time, xy.data(), nBeams);
+            }
+            else urgAppendCsvScan(text, time, (const float*)(record.data() + sizeof(time)), nBeams);
+            nScans++;
+
+            if (text.size() >= (1 << 20)) {
+                out.write(text.data(), text.size());
+                text.clear();
+            }
+        }
+    }
+    else {
+
+        // decode one chunk at a time
+        vector<char> chunk;
+        vector<uint32_t> times;
+        vector<int32_t> ranges;
+        vector<float> xy(2 * nBeams);
+        char headerBytes[sizeof(urgChunkHeader)];
+        urgChunkHeader chunkHeader;
+        uint64_t fileSize = in.getSize();
+        uint64_t offset = header.headerSize;
+
+        while (in.read(headerBytes, sizeof(headerBytes))) {
+
+            // check the header against the bytes left in the file before it sizes anything
+            offset += sizeof(headerBytes);
+            bool valid = offset <= fileSize && urgReadChunkHeader(headerBytes, sizeof(headerBytes) + (fileSize - offset), chunkHeader);
+            if (valid) {
+                chunk.resize(sizeof(chunkHeader) + chunkHeader.payloadSize);
+                memcpy(chunk.data(), headerBytes, sizeof(headerBytes));
+                in.read(chunk.data() + sizeof(chunkHeader), chunkHeader.payloadSize);
+                valid = (uint64_t)in.gcount() == chunkHeader.payloadSize;
+                offset += chunkHeader.payloadSize;
+            }
+            if (valid) {
+                times.resize(chunkHeader.nScans);
+                ranges.resize((size_t)chunkHeader.nScans * nBeams);
+                valid = urgDecodeChunk(chunk.data(), chunk.size(), nBeams, times.data(), ranges.data(), header.version >= URG_CHUNK_RUNS_VERSION);
+            }
+            if (!valid) {
+                ofLogWarning("urgFormat") << binaryFileName << " ends with a damaged chunk after scan " << nScans;
+                break;
+            }
+
+            for (uint32_t s = 0; s < chunkHeader.nScans; s++) {
+                urgRangesToCartesian(&ranges[(size_t)s * nBeams], cosines.data(), sines.data(), nBeams, xy.data());
+                urgAppendCsvScan(text, times[s], xy.data(), nBeams);
+                nScans++;
+            }
+
+            if (text.size() >= (1 << 20)) {
+                out.write(text.data(), text.size());
+                text.clear();
+            }
+        }
+    }
+    out.write(text.data(), text.size());
+
+    ofLogNotice("urgFormat") << "converted " << nScans << " scans to " << csvFileName;
+    return true;
+}
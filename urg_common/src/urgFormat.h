@@ -0,0 +1,124 @@
+//
+//  urgFormat.h
+//  urg_common
+//
+//  Binary scan recording format shared by urg_record (writer) and
+//  urg_display (reader), plus a converter back to the CSV layout.
+//
+
+#ifndef __urg_common__urgFormat__
+#define __urg_common__urgFormat__
+
+#include "ofMain.h"
+
+/* A binary recording is a 64 byte header followed by one fixed-size record
+   per scan. All values are little endian.
+
+        header  | magic "URGB" | version | headerSize | beamCount | sensorId |
+                | angularResolution | startAngle | startTime | layout | recordSize |
+        record  | time (uint32, ms since first scan) | x0 y0 x1 y1 ... (float32, mm) |
+
+   A compressed recording (layout URG_LAYOUT_DELTA_RANGES) has the same
+   header, followed by the angle of every beam and then chunks of scans
+   coded as described in urgCodec.h (recordSize is 0).
+
+        angles  | angle of beam 0, 1, 2 ... (float32, radians) |
+
+   A polar recording (layout URG_LAYOUT_POLAR) has the header and the beam
+   angles, then fixed-size records of the ranges the sensor sent, left for
+   the reader to convert.
+
+        record  | time (uint32, ms since first scan) | r0 r1 r2 ... (int32, mm) |
+
+   A long recording can be split into segments, each a complete recording
+   of its own named <name>_seg0000.<ext>, <name>_seg0001.<ext> ... Times
+   count from the first scan of the whole session, and binary segments
+   share the session's header apart from the segment number.
+ */
+
+// version 2 compressed recordings code runs of unchanged beams (see urgCodec.h)
+#define URG_BINARY_MAGIC "URGB"
+#define URG_BINARY_VERSION 2
+#define URG_BINARY_EXTENSION "urg"
+#define URG_SEGMENT_TAG "_seg"
+
+// layout of the per-scan records that follow the header
+enum urgRecordingLayout {
+    URG_LAYOUT_CARTESIAN = 0,       // time, then interleaved float x/y per beam
+    URG_LAYOUT_DELTA_RANGES = 1,    // chunks of delta coded integer ranges (see urgCodec.h)
+    URG_LAYOUT_POLAR = 2            // time, then int32 range per beam
+};
+
+// what urg_record writes
+enum urgRecordingFormat {
+    URG_FORMAT_CSV = 0,
+    URG_FORMAT_BINARY = 1,          // URG_LAYOUT_CARTESIAN
+    URG_FORMAT_COMPRESSED = 2,      // URG_LAYOUT_DELTA_RANGES
+    URG_FORMAT_POLAR = 3            // URG_LAYOUT_POLAR
+};
+
+#pragma pack(push, 1)
+struct urgRecordingHeader {
+    char magic[4];              // URG_BINARY_MAGIC
+    uint16_t version;           // URG_BINARY_VERSION
+    uint16_t headerSize;        // bytes before the first record
+    uint32_t beamCount;         // beams per scan (682 for the URG-04LX)
+    uint32_t sensorId;          // id of the sensor (defaults to its osc port)
+    float angularResolution;    // radians between adjacent beams
+    float startAngle;           // radians of beam 0
+    uint64_t startTime;         // unix time (ms) of the first scan
+    uint32_t layout;            // urgRecordingLayout
+    uint32_t recordSize;        // bytes per scan record
+    uint64_t sessionId;         // shared by the segments of a recording (0 if it isn't segmented)
+    uint32_t segment;           // index of this segment in the session
+    uint8_t reserved[12];       // zero; pads the header to 64 bytes
+};
+#pragma pack(pop)
+
+// bytes of a cartesian record holding nBeams beams
+inline size_t urgCartesianRecordSize(uint32_t nBeams) {
+    return sizeof(uint32_t) + 2 * sizeof(float) * nBeams;
+}
+
+// size of one record in the polar layout
+inline size_t urgPolarRecordSize(uint32_t nBeams) {
+    return sizeof(uint32_t) + sizeof(int32_t) * nBeams;
+}
+
+// whether a layout's header is followed by a table of beam angles
+inline bool urgHasAngleTable(uint32_t layout) {
+    return layout != URG_LAYOUT_CARTESIAN;
+}
+
+// fill a header for a new recording
+urgRecordingHeader urgMakeHeader(uint32_t beamCount, float angularResolution, float startAngle, uint32_t sensorId, uint64_t startTime, uint32_t layout = URG_LAYOUT_CARTESIAN);
+
+// check whether a block of data (the start of a file) holds a valid binary header
+// header is filled if valid
+bool urgReadHeader(const char* data, size_t size, urgRecordingHeader& header);
+
+// current unix time in milliseconds (used for startTime)
+uint64_t urgUnixTimeMillis();
+
+// a new id for a recording session (never 0)
+uint64_t urgMakeSessionId();
+
+// name of segment i of a recording: <name>_seg0000.<ext> for <name>.<ext>
+string urgSegmentFileName(string fileName, int segment);
+
+// if fileName is a segment, the names of every segment of its session, in
+// order (as far as they're consecutive from segment 0); false if it isn't
+// one, or comes after a missing segment
+bool urgFindSegments(string fileName, vector<string>& segmentNames);
+
+// append one scan to a string in the CSV layout written by urg_record:
+//      time   x0  y0  x1  y1  x2  y2 ...
+void urgAppendCsvScan(string& out, unsigned long time, const float* xy, uint32_t nBeams);
+
+// convert a scan of ranges (mm) to interleaved x/y (mm), given the cos and sin of each beam's angle
+void urgRangesToCartesian(const int32_t* ranges, const float* cosines, const float* sines, uint32_t nBeams, float* xy);
+
+// convert a binary, compressed or polar recording to the CSV layout; returns false if the input is not one
+bool urgConvertToCsv(string binaryFileName, string csvFileName);
+
+#endif /* defined(__urg_common__urgFormat__) */
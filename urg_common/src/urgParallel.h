@@ -0,0 +1,61 @@
+//
+//  urgParallel.h
+//  urg_common
+//
+//  Splits a loop over [0, n) into contiguous chunks run on one thread per core.
+//
+
+#ifndef __urg_common__urgParallel__
+#define __urg_common__urgParallel__
+
+#include "ofMain.h"
+#include <thread>
+#include <atomic>
+
+// most threads to split work across, when it's set (0 for one per core)
+inline std::atomic<int>& urgThreadLimit() {
+    static std::atomic<int> limit(0);
+    return limit;
+}
+
+// split work across at most n threads from now on (0 for one per core),
+// e.g. when the callers already run on several threads of their own
+inline void urgSetNumThreads(int n) {
+    urgThreadLimit() = max(n, 0);
+}
+
+// number of threads to split work across
+inline int urgNumThreads() {
+    int limit = urgThreadLimit();
+    return (limit > 0) ? limit : max(1, (int)std::thread::hardware_concurrency());
+}
+
+// number of chunks urgParallelFor() splits n items into
+// (chunks hold at least minChunk items, so small loops run on fewer threads)
+inline int urgNumChunks(size_t n, size_t minChunk = 1) {
+
+    if (n == 0) return 0;
+    size_t nChunks = min((size_t)urgNumThreads(), max((size_t)1, n / max(minChunk, (size_t)1)));
+    size_t chunkSize = (n + nChunks - 1) / nChunks;
+    return (n + chunkSize - 1) / chunkSize;
+}
+
+// call func(chunk, begin, end) for contiguous chunks covering [0, n), in parallel
+// chunk runs from 0 to urgNumChunks(n, minChunk) - 1
+template<class Func>
+void urgParallelFor(size_t n, Func func, size_t minChunk = 1) {
+
+    size_t nChunks = urgNumChunks(n, minChunk);
+    if (nChunks == 0) return;
+    size_t chunkSize = (n + nChunks - 1) / nChunks;
+
+    // the calling thread runs the first chunk itself
+    vector<std::thread> threads;
+    for (size_t c = 1; c < nChunks; c++) {
+        threads.push_back(std::thread(func, (int)c, c * chunkSize, min(n, (c + 1) * chunkSize)));
+    }
+    func(0, (size_t)0, min(n, chunkSize));
+    for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+}
+
+#endif /* defined(__urg_common__urgParallel__) */
@@ -0,0 +1,329 @@
+//
+//  main.cpp
+//  urg_convert
+//
+//  Command-line converter from recordings to point cloud files, without a
+//  window. Fills meshes with the same urgDisplay code as urg_display and
+//  converts several recordings at once, one per core.
+//
+//      urg_convert [options] recording [recording ...]
+//
+//  Run without arguments for the list of options.
+//
+
+#include "ofMain.h"
+#include "urgDisplay.h"
+#include "urgExport.h"
+#include "urgFormat.h"
+#include "urgParallel.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// seconds since an arbitrary point
+static double now() {
+    using namespace std::chrono;
+    return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+// ---------------------------------------------------------------------
+
+// everything given on the command line
+struct convertSettings {
+
+    bool spherical = false;
+    bool toCsv = false;
+    urgExportType type = URG_EXPORT_PLY_BINARY;
+    string outDir;
+    int nJobs = 0;
+    int cacheMB = 2048;         // parsed scans held by all the jobs together
+
+    // fillLinearMesh
+    int startScan = 0;
+    int endScan = -1;
+    int zScale = 300;
+    bool timeDependent = false;
+
+    // fillSphericalMesh
+    float speed = 225./64.;
+    float period = 180;
+    float startingPeriod = 0;
+    float nPeriods = 1;
+    bool clockwise = true;
+    float alignmentAngle = 0;
+    bool cullDuplicateScans = true;
+    float outlierStdDevs = 0;   // off when 0
+    int outlierRadius = 1;
+
+    // both
+    int minIndex = 0;
+    int maxIndex = 682;
+    int cullDistance = 265;
+
+    // downsampling (off when voxelSize is 0)
+    float voxelSize = 0;
+    urgVoxelMode voxelMode = URG_VOXEL_CENTROID;
+
+    vector<string> fileNames;
+};
+
+// what converting one recording produced
+struct convertResult {
+    bool ok = false;
+    unsigned long nScans = 0;
+    size_t nPoints = 0;
+    size_t nFilledPoints = 0;
+    size_t nOutliers = 0;
+    uint64_t nBytes = 0;
+    double seconds = 0;
+};
+
+// ---------------------------------------------------------------------
+
+static void printUsage() {
+
+    cout << "usage: urg_convert [options] recording [recording ...]\n"
+            "\n"
+            "converts csv or binary (.urg) recordings to point clouds\n"
+            "\n"
+            "  --linear                 linear recordings (default)\n"
+            "  --spherical              spherical recordings\n"
+            "  --format F               ply (binary, default), ply-ascii, csv or raw\n"
+            "  --csv                    convert binary recordings to csv instead of point clouds\n"
+            "  --out DIR                write next to the recordings unless given\n"
+            "  --jobs N                 recordings converted at once (default: one per core)\n"
+            "  --cache-mb MB            memory the jobs together can hold parsed\n"
+            "                           recordings in; longer ones are parsed as they're read (2048)\n"
+            "\n"
+            "  --min-index N            lower bound of beams to include (0)\n"
+            "  --max-index N            upper bound of beams to include (682)\n"
+            "  --cull-distance MM       discard points this close to the lidar (265)\n"
+            "  --voxel MM               keep one point per cell of this size (off)\n"
+            "  --voxel-first            keep each cell's first point instead of its centroid\n"
+            "\n"
+            "linear:\n"
+            "  --start-scan N           first scan to include (0)\n"
+            "  --end-scan N             scan to stop before, -1 for the end (-1)\n"
+            "  --z-scale MM             distance traveled per sec (300)\n"
+            "  --time-dependent         space scans by the time they were captured\n"
+            "\n"
+            "spherical:\n"
+            "  --speed DEG              speed of the rotating lidar in degrees / sec (3.515625)\n"
+            "  --period DEG             degrees in one period of rotation (180)\n"
+            "  --starting-period P      period at which to start loading points (0)\n"
+            "  --periods P              number of periods to load (1)\n"
+            "  --counterclockwise       the lidar was rotating counterclockwise\n"
+            "  --alignment-angle DEG    offset a single scan by this angle (0)\n"
+            "  --keep-duplicate-scans   don't cull scans the sensor sent twice\n"
+            "  --outliers SD            drop points whose distances to their neighbours are\n"
+            "                           this many standard deviations above the mean (off)\n"
+            "  --outlier-radius N       neighbours are up to this many beams and scans away (1)\n";
+}
+
+// ---------------------------------------------------------------------
+
+// parse the command line; returns false (after saying why) if it's unusable
+static bool parseArguments(int argc, char** argv, convertSettings& settings) {
+
+    for (int i = 1; i < argc; i++) {
+
+        string arg = argv[i];
+
+        // options without a value
+        if (arg == "--linear") { settings.spherical = false; continue; }
+        if (arg == "--spherical") { settings.spherical = true; continue; }
+        if (arg == "--csv") { settings.toCsv = true; continue; }
+        if (arg == "--time-dependent") { settings.timeDependent = true; continue; }
+        if (arg == "--counterclockwise") { settings.clockwise = false; continue; }
+        if (arg == "--keep-duplicate-scans") { settings.cullDuplicateScans = false; continue; }
+        if (arg == "--voxel-first") { settings.voxelMode = URG_VOXEL_FIRST; continue; }
+
+        if (arg.size() < 2 || arg.substr(0, 2) != "--") {
+            settings.fileNames.push_back(ofFilePath::getAbsolutePath(arg, false));
+            continue;
+        }
+
+        // options with a value
+        if (i + 1 >= argc) {
+            cerr << "urg_convert: " << arg << " needs a value" << endl;
+            return false;
+        }
+        string value = argv[++i];
+
+        if (arg == "--format") {
+            if (value == "ply") settings.type = URG_EXPORT_PLY_BINARY;
+            else if (value == "ply-ascii") settings.type = URG_EXPORT_PLY_ASCII;
+            else if (value == "csv") settings.type = URG_EXPORT_CSV;
+            else if (value == "raw") settings.type = URG_EXPORT_RAW;
+            else {
+                cerr << "urg_convert: unknown format " << value << endl;
+                return false;
+            }
+        }
+        else if (arg == "--out") settings.outDir = ofFilePath::getAbsolutePath(value, false);
+        else if (arg == "--jobs") settings.nJobs = ofToInt(value);
+        else if (arg == "--cache-mb") settings.cacheMB = max(ofToInt(value), 0);
+        else if (arg == "--min-index") settings.minIndex = ofToInt(value);
+        else if (arg == "--max-index") settings.maxIndex = ofToInt(value);
+        else if (arg == "--cull-distance") settings.cullDistance = ofToInt(value);
+        else if (arg == "--voxel") settings.voxelSize = ofToFloat(value);
+        else if (arg == "--start-scan") settings.startScan = ofToInt(value);
+        else if (arg == "--end-scan") settings.endScan = ofToInt(value);
+        else if (arg == "--z-scale") settings.zScale = ofToInt(value);
+        else if (arg == "--speed") settings.speed = ofToFloat(value);
+        else if (arg == "--period") settings.period = ofToFloat(value);
+        else if (arg == "--starting-period") settings.startingPeriod = ofToFloat(value);
+        else if (arg == "--periods") settings.nPeriods = ofToFloat(value);
+        else if (arg == "--alignment-angle") settings.alignmentAngle = ofToFloat(value);
+        else if (arg == "--outliers") settings.outlierStdDevs = ofToFloat(value);
+        else if (arg == "--outlier-radius") settings.outlierRadius = ofToInt(value);
+        else {
+            cerr << "urg_convert: unknown option " << arg << endl;
+            return false;
+        }
+    }
+
+    if (settings.fileNames.empty()) {
+        printUsage();
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------
+
+// file to write for a recording: the recording's name with a new extension
+static string outputName(const convertSettings& settings, string fileName, string extension) {
+
+    string dir = settings.outDir.empty() ? ofFilePath::getEnclosingDirectory(fileName, false) : settings.outDir;
+    return ofFilePath::join(dir, ofFilePath::getBaseName(fileName) + "." + extension);
+}
+
+// ---------------------------------------------------------------------
+
+static convertResult convertRecording(const convertSettings& settings, string fileName, int nJobs) {
+
+    convertResult result;
+    double start = now();
+
+    ofFile file(fileName, ofFile::ReadOnly, true);
+    if (!file.exists()) {
+        ofLogError("urg_convert") << "no such file " << fileName;
+        return result;
+    }
+    result.nBytes = file.getSize();
+    file.close();
+
+    if (settings.toCsv) {
+
+        // binary recording to csv
+        result.ok = urgConvertToCsv(fileName, outputName(settings, fileName, "csv"));
+    }
+    else {
+
+        // recording to mesh to point cloud
+        // (each job holds its share of the parsed scans, so they fit together)
+        urgDisplay urg;
+        urg.linearScanCacheMB = settings.cacheMB / max(nJobs, 1);
+        urg.sphericalScanCacheMB = urg.linearScanCacheMB;
+        ofMesh* mesh;
+        urgRecording& recording = settings.spherical ? urg.sphericalRecording : urg.linearRecording;
+        bool loaded = settings.spherical ? urg.loadSphericalData(fileName) : urg.loadLinearData(fileName);
+        if (!loaded || recording.getNumScans() == 0) {
+            ofLogError("urg_convert") << fileName << (loaded ? " holds no scans" : " could not be read");
+            result.seconds = now() - start;
+            return result;
+        }
+        if (settings.spherical) {
+            urg.fillSphericalMesh(settings.speed, settings.period, settings.startingPeriod, settings.nPeriods, settings.minIndex, settings.maxIndex, settings.clockwise, settings.cullDistance, settings.alignmentAngle, ofColor(255), settings.cullDuplicateScans);
+            result.nScans = urg.nSphericalScans;
+            result.nFilledPoints = urg.sphericalMesh.getNumVertices();
+            if (settings.outlierStdDevs > 0) result.nOutliers = urg.removeSphericalOutliers(settings.outlierStdDevs, settings.outlierRadius);
+            mesh = &urg.sphericalMesh;
+        }
+        else {
+            urg.fillLinearMesh(settings.startScan, settings.endScan, settings.zScale, settings.minIndex, settings.maxIndex, settings.timeDependent, settings.cullDistance, ofColor(255));
+            result.nScans = urg.nLinearScans;
+            result.nFilledPoints = urg.linearMesh.getNumVertices();
+            mesh = &urg.linearMesh;
+        }
+
+        // (a recording whose scans can't be parsed fills nothing)
+        if (result.nFilledPoints == 0) {
+            ofLogError("urg_convert") << fileName << " has no readable points to convert";
+            result.seconds = now() - start;
+            return result;
+        }
+
+        if (settings.voxelSize > 0) urgVoxelDownsample(*mesh, *mesh, settings.voxelSize, settings.voxelMode);
+
+        const vector<ofVec3f>& points = mesh->getVertices();
+        result.nPoints = points.size();
+        result.ok = urgExportPoints(outputName(settings, fileName, urgExportExtension(settings.type)), points.data(), points.size(), settings.type);
+    }
+
+    result.seconds = now() - start;
+    return result;
+}
+
+//========================================================================
+int main(int argc, char** argv) {
+
+    convertSettings settings;
+    if (!parseArguments(argc, argv, settings)) return 1;
+
+    // recordings are handed out to the workers in order
+    int nFiles = settings.fileNames.size();
+    int nJobs = min(settings.nJobs > 0 ? settings.nJobs : urgNumThreads(), nFiles);
+
+    // each job's fills, filters and exports split their work between the
+    // cores left to it, so the jobs together run a thread per core
+    urgSetNumThreads(max(urgNumThreads() / max(nJobs, 1), 1));
+    vector<convertResult> results(nFiles);
+    std::atomic<int> nextFile(0);
+    std::mutex printMutex;
+
+    double start = now();
+
+    auto worker = [&]() {
+        int f;
+        while ((f = nextFile++) < nFiles) {
+            results[f] = convertRecording(settings, settings.fileNames[f], nJobs);
+
+            const convertResult& r = results[f];
+            std::lock_guard<std::mutex> lock(printMutex);
+            cout << (r.ok ? "converted " : "failed ") << settings.fileNames[f]
+                 << " scans=" << r.nScans << " points=" << r.nPoints
+                 << " outliers=" << r.nOutliers
+                 << " reduction=" << (r.nPoints > 0 ? (double)r.nFilledPoints / r.nPoints : 0)
+                 << " seconds=" << r.seconds << endl;
+        }
+    };
+
+    // the main thread is one of the workers
+    vector<std::thread> threads;
+    for (int j = 1; j < nJobs; j++) threads.push_back(std::thread(worker));
+    worker();
+    for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+
+    double seconds = now() - start;
+
+    // throughput over all the recordings
+    int nFailed = 0;
+    unsigned long nScans = 0;
+    size_t nPoints = 0;
+    uint64_t nBytes = 0;
+    for (int f = 0; f < nFiles; f++) {
+        if (!results[f].ok) nFailed++;
+        nScans += results[f].nScans;
+        nPoints += results[f].nPoints;
+        nBytes += results[f].nBytes;
+    }
+    cout << "total files=" << nFiles << " failed=" << nFailed << " jobs=" << nJobs
+         << " seconds=" << seconds
+         << " scans_per_s=" << nScans / seconds
+         << " points_per_s=" << nPoints / seconds
+         << " input_mb_per_s=" << nBytes / (1024. * 1024.) / seconds << endl;
+
+    return nFailed == 0 ? 0 : 1;
+}
@@ -31,6 +31,9 @@ void ofApp::setup(){
     
     urg.loadSphericalData("spherical_test.csv");
     urg.fillSphericalMesh(225./64., 180, 0, 1, 0, 682, true, 265, 3, ofColor(255), true);
+    
+    // drop the mixed pixels along edges, and spray
+    urg.removeSphericalOutliers(2, 1);
     panel.add(urg.sphericalParams);
     
 #endif
@@ -42,6 +45,13 @@ void ofApp::setup(){
 //--------------------------------------------------------------
 void ofApp::update(){
 
+#ifndef spherical
+    
+    // apply any change to the scan window, or move the playback window along
+    urg.updateLinearWindow();
+    urg.updateLinearPlayback(ofGetLastFrameTime());
+    
+#endif
 }
 
 //--------------------------------------------------------------
@@ -64,7 +74,7 @@ void ofApp::draw(){
         panel.draw();
         ofDrawBitmapStringHighlight(ofToString(ofGetFrameRate()), 10, 20);
     }
-    ofDrawBitmapStringHighlight("L / R arrow keys slide linear or rotate spherical\nU / D arrow keys scale model up and down\nb for debug\ns for auto slide, r for auto rotate\nc to hide cursor\nf for fullscreen", 10, ofGetHeight() - 80);
+    ofDrawBitmapStringHighlight("L / R arrow keys slide linear or rotate spherical\nU / D arrow keys scale model up and down\nb for debug\ns for auto slide, r for auto rotate\np for playback\nc to hide cursor\nf for fullscreen", 10, ofGetHeight() - 94);
 }
 
 //--------------------------------------------------------------
@@ -132,4 +142,10 @@ void ofApp::gotMessage(ofMessage msg){
 //--------------------------------------------------------------
 void ofApp::dragEvent(ofDragInfo dragInfo){ 
 
+    // drop binary recordings onto the window to convert them to csv
+    for (int i = 0; i < dragInfo.files.size(); i++) {
+        if (ofFile(dragInfo.files[i]).getExtension() == URG_BINARY_EXTENSION) {
+            urg.convertToCsv(dragInfo.files[i]);
+        }
+    }
 }
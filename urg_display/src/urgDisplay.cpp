@@ -7,6 +7,8 @@
 //
 
 #include "urgDisplay.h"
+#include "urgParallel.h"
+#include "urgExport.h"
 
 urgDisplay::urgDisplay() {
     
@@ -33,6 +35,23 @@ urgDisplay::urgDisplay() {
     linearParams.add(mirrorX.set("Mirror X", false));
     linearParams.add(mirrorY.set("Mirror Y", false));
     linearParams.add(mirrorZ.set("Mirror Z", false));
+    linearParams.add(linearLevelOfDetail.set("Level of Detail", false));
+    linearParams.add(linearPointBudget.set("Point Budget", 2000000, 10000, 20000000));
+    
+    linearWindowParams.setName("Window");
+    linearWindowParams.add(linearStartScan.set("Start Scan", 0, 0, 1000));
+    linearWindowParams.add(linearEndScan.set("End Scan", -1, -1, 1000));
+    linearWindowParams.add(linearMinIndex.set("Min Index", 0, 0, 682));
+    linearWindowParams.add(linearMaxIndex.set("Max Index", 682, 0, 682));
+    linearWindowParams.add(linearCullDistance.set("Cull Distance", 265, 0, 2000));
+    linearParams.add(linearWindowParams);
+    
+    linearPlaybackParams.setName("Playback");
+    linearPlaybackParams.add(linearPlayback.set("Playback", false));
+    linearPlaybackParams.add(linearPlaybackSpeed.set("Speed", 1, -16, 16));
+    linearPlaybackParams.add(linearPlaybackScans.set("Window Scans", 300, 1, 10000));
+    linearPlaybackParams.add(linearPlaybackSeconds.set("Window Seconds", 0, 0, 600));
+    linearParams.add(linearPlaybackParams);
     
     sphericalParams.setName("Spherical Mesh Params");
     sphericalParams.add(sphericalScale.set("Scale", 0.5, 0, 2));
@@ -45,88 +64,518 @@ urgDisplay::urgDisplay() {
     sphericalParams.add(flipX.set("Flip X", false));
     sphericalParams.add(flipY.set("Flip Y", false));
     sphericalParams.add(flipZ.set("Flip Z", false));
+    sphericalParams.add(sphericalLevelOfDetail.set("Level of Detail", false));
+    sphericalParams.add(sphericalPointBudget.set("Point Budget", 2000000, 10000, 20000000));
     
 }
 
 // ---------------------------------------------------------------------
 
-void urgDisplay::loadLinearData(string fileName) {
+bool urgDisplay::loadLinearData(string fileName) {
     
-    ofFile file(fileName);
+    // the prefetch thread reads the recording being replaced
+    closeLinearPlayback();
     
-    linearBuffer = ofBuffer(file);
+    bool loaded = linearRecording.load(fileName);
+    linearScanCache.clear();
+    if (linearScanCacheMB > 0 && !linearScanCache.build(linearRecording, (size_t)linearScanCacheMB << 20)) {
+        ofLogNotice("urgDisplay") << fileName << " is too long to hold parsed; its scans are parsed as they're needed";
+    }
+    
+    // the parsed scans belonged to the last recording
+    linearCache.clear();
+    linearCacheValid.clear();
+    linearCacheVertices.clear();
+    linearFilled = false;
+    return loaded;
 }
 
 // ---------------------------------------------------------------------
 
 void urgDisplay::fillLinearMesh(int startScan, int endScan, int zScale, int minIndex, int maxIndex, bool timeDependent, int cullDistance, ofColor color) {
 
-    // clear the existing mesh of any points
-    linearMesh.clear();
+    // forget the parsed scans (and any playback window) and start over
+    closeLinearPlayback();
+    linearCache.clear();
+    linearCacheValid.clear();
+    linearCacheVertices.clear();
+    linearFilled = false;
+    
+    updateLinearMesh(startScan, endScan, zScale, minIndex, maxIndex, timeDependent, cullDistance, color);
+    
+    // the window controls start from this fill
+    int nScans = linearRecording.getNumScans();
+    linearStartScan.setMax(nScans);
+    linearEndScan.setMax(nScans);
+    linearStartScan = startScan;
+    linearEndScan = endScan;
+    linearMinIndex = minIndex;
+    linearMaxIndex = maxIndex;
+    linearCullDistance = cullDistance;
+}
+
+// ---------------------------------------------------------------------
+
+void urgDisplay::updateLinearMesh(int startScan, int endScan, int zScale, int minIndex, int maxIndex, bool timeDependent, int cullDistance, ofColor color) {
     
-    // reset number of scans
-    nLinearScans = 0;
+    linearFill fill = { startScan, endScan, zScale, minIndex, maxIndex, cullDistance, timeDependent };
+    const linearFill& last = lastLinearFill;
     
-    // starting time of the first specified scan (seconds)
-    float timeZero;
+    bool sameWindow = linearFilled && startScan == last.startScan && endScan == last.endScan;
+    bool sameFilter = linearFilled && zScale == last.zScale && minIndex == last.minIndex && maxIndex == last.maxIndex && timeDependent == last.timeDependent && cullDistance == last.cullDistance;
+    if (sameWindow && sameFilter) return;
     
-    // get iterator to the first scan
-    ofBuffer::Line it = linearBuffer.getLines().begin();
-    advance(it, startScan);
-    // get iterator to the last scan
+    // scans [begin, end) are in the window
         // if endScan = -1, go to the end
-        // if endScan is specified (not -1), then go up to that scan number
-    ofBuffer::Line end = linearBuffer.getLines().end();
-    if (endScan != -1) {
-        end = linearBuffer.getLines().begin();
-        advance(end, endScan - 1);
+        // if endScan is specified (not -1), then go up to (but not including) scan endScan - 1
+    unsigned long nScans = linearRecording.getNumScans();
+    unsigned long begin = min((unsigned long)max(startScan, 0), nScans);
+    unsigned long end = (endScan == -1) ? nScans : (endScan < 1) ? 0 : min((unsigned long)endScan - 1, nScans);
+    end = max(begin, end);
+    
+    unsigned long cacheEnd = linearCacheStart + linearCacheValid.size();
+    bool parsed = isLinearParsed();
+    
+    // the points of the scans still in the window can stay in the mesh when
+    // they would be placed the same way: same filter and same first scan
+    bool rebuild = !sameFilter || linearCacheValid.empty() || begin != linearCacheStart;
+    
+    // a window that doesn't overlap the cached scans starts the cache over
+    if (end <= linearCacheStart || begin >= cacheEnd) {
+        linearCache.clear();
+        linearCacheValid.clear();
+        linearCacheVertices.clear();
+        linearCacheStart = begin;
+        cacheEnd = begin;
+        rebuild = true;
+    }
+    
+    // drop the scans that left the window
+    int nTrimmed = 0;
+    while (cacheEnd > end) {
+        if (linearCacheValid.back()) nLinearScans--;
+        if (!linearCacheVertices.empty()) {
+            nTrimmed += linearCacheVertices.back();
+            linearCacheVertices.pop_back();
+        }
+        if (!linearCache.empty()) linearCache.pop_back();
+        linearCacheValid.pop_back();
+        cacheEnd--;
+    }
+    while (linearCacheStart < begin) {
+        if (!linearCache.empty()) linearCache.pop_front();
+        linearCacheValid.pop_front();
+        linearCacheStart++;
+    }
+    if (!rebuild && nTrimmed > 0) {
+        size_t nVertices = linearMesh.getNumVertices() - nTrimmed;
+        linearMesh.getVertices().resize(nVertices);
+        linearMesh.getColors().resize(nVertices);
     }
     
-    // iterate through all specified scans
-    for (it; it != end; ++it) {
+    // take in the scans that entered the window (parsed already, or read now)
+    vector<urgScan> scans;
+    vector<bool> valid;
+    if (begin < linearCacheStart) {
+        if (parsed) {
+            for (unsigned long i = linearCacheStart; i-- > begin; ) linearCacheValid.push_front(linearScanCache.isValid(i));
+        }
+        else {
+            readLinearScans(begin, linearCacheStart, scans, valid);
+            for (size_t i = scans.size(); i-- > 0; ) {
+                linearCache.push_front(urgScan());
+                swap(linearCache.front(), scans[i]);
+                linearCacheValid.push_front(valid[i]);
+            }
+        }
+        linearCacheStart = begin;
+    }
+    if (cacheEnd < end) {
+        if (!parsed) readLinearScans(cacheEnd, end, scans, valid);
+        for (unsigned long i = cacheEnd; i < end; i++) {
+            if (parsed) linearCacheValid.push_back(linearScanCache.isValid(i));
+            else {
+                linearCache.push_back(urgScan());
+                swap(linearCache.back(), scans[i - cacheEnd]);
+                linearCacheValid.push_back(valid[i - cacheEnd]);
+            }
+            
+            // the mesh already holds the scans before these: only add the new ones
+            if (!rebuild) linearCacheVertices.push_back(addLinearScan(i, fill));
+        }
+    }
+    
+    if (rebuild) {
         
-        // get the line and split it by commas
-        string line = *it;
-        // skip if line is empty
-        if (line.empty() == true) continue;
-        vector<string> items = ofSplitString(line, ",");
+        // clear the existing mesh of any points and place every scan in the window again
+        linearMesh.clear();
+        nLinearScans = 0;
+        linearCacheVertices.clear();
+        for (size_t i = 0; i < linearCacheValid.size(); i++) {
+            linearCacheVertices.push_back(addLinearScan(linearCacheStart + i, fill));
+        }
+    }
+    
+    lastLinearFill = fill;
+    linearFilled = true;
+    linearOctreeDirty = true;
+}
+
+// ---------------------------------------------------------------------
+
+void urgDisplay::updateLinearWindow() {
+    
+    if (!linearFilled || linearPlaying) return;
+    updateLinearMesh(linearStartScan, linearEndScan, lastLinearFill.zScale, linearMinIndex, linearMaxIndex, lastLinearFill.timeDependent, linearCullDistance);
+}
+
+// ---------------------------------------------------------------------
+
+void urgDisplay::readLinearScans(unsigned long begin, unsigned long end, vector<urgScan>& scans, vector<bool>& valid) {
+    
+    scans.assign(end - begin, urgScan());
+    valid.assign(end - begin, false);
+    
+    // read straight through, so malformed scans are reported and skipped (and stay invalid)
+    linearRecording.seekScan(begin);
+    urgScan scan;
+    while (linearRecording.getScanIndex() < end && linearRecording.nextScan(scan, false)) {
         
-        // if time-dependent, find current time
-        float timeNow;
-        if (timeDependent) {
-            if (nLinearScans == 0) {    // first scan
-                timeZero = ofToFloat(items[0]) / 1000.;
-                timeNow = 0;
-            } else {                    // not first scan
-                timeNow = ofToFloat(items[0]) / 1000. - timeZero;
-            }
+        // (getScanIndex() is now one past the scan just read)
+        unsigned long i = linearRecording.getScanIndex() - 1;
+        if (i >= end) break;
+        swap(scans[i - begin], scan);
+        valid[i - begin] = true;
+    }
+}
+
+// ---------------------------------------------------------------------
+
+bool urgDisplay::isLinearParsed() {
+    return linearScanCache.isBuilt() && !linearPlaying;
+}
+
+// ---------------------------------------------------------------------
+
+urgDisplay::scanView urgDisplay::viewScan(const urgScan& scan) {
+    
+    scanView view = { scan.time, 0, NULL, NULL, NULL, 2 };
+    if (!scan.ranges.empty()) {
+        view.nBeams = scan.ranges.size();
+        view.ranges = scan.ranges.data();
+    }
+    else if (!scan.points.empty()) {
+        view.nBeams = scan.points.size();
+        view.x = &scan.points[0].x;
+        view.y = &scan.points[0].y;
+    }
+    return view;
+}
+
+urgDisplay::scanView urgDisplay::viewScan(urgScanCache& cache, unsigned long i) {
+    
+    // straight from the parsed rows
+    scanView view = { cache.getTime(i), cache.getScanBeams(i), NULL, NULL, NULL, 1 };
+    if (cache.hasRanges()) view.ranges = cache.getRanges(i);
+    else {
+        view.x = cache.getX(i);
+        view.y = cache.getY(i);
+    }
+    return view;
+}
+
+urgDisplay::scanView urgDisplay::viewLinearScan(unsigned long i) {
+    
+    if (!isLinearParsed()) return viewScan(linearCache[i - linearCacheStart]);
+    return viewScan(linearScanCache, i);
+}
+
+// ---------------------------------------------------------------------
+
+int urgDisplay::addLinearScan(unsigned long i, const linearFill& fill) {
+    
+    if (!linearCacheValid[i - linearCacheStart]) return 0;
+    scanView scan = viewLinearScan(i);
+    
+    // if time-dependent, find current time
+    float timeNow;
+    if (fill.timeDependent) {
+        if (nLinearScans == 0) {    // first scan
+            linearTimeZero = scan.time / 1000.;
+            timeNow = 0;
+        } else {                    // not first scan
+            timeNow = scan.time / 1000. - linearTimeZero;
         }
+    }
+    
+    // if time dependent, graph depth (pz) proportional to elapsed time; otherwise, graph with constant spacing (assume a new reading is taken every 100 ms)
+    float pz = (fill.timeDependent) ? (timeNow * fill.zScale) : ((float)nLinearScans / 10. * fill.zScale);
+    
+    // add each specified point of the scan to the mesh
+    int nAdded = placeLinearScan(scan, pz, fill, linearMesh.getVertices());
+    linearMesh.getColors().resize(linearMesh.getNumVertices(), ofFloatColor(1));
+    
+    // increment scan number
+    nLinearScans++;
+    return nAdded;
+}
+
+// ---------------------------------------------------------------------
+
+int urgDisplay::placeLinearScan(const scanView& scan, float pz, const linearFill& fill, vector<ofVec3f>& vertices) {
+    
+    int nAdded = 0;
+    int lastIndex = min(fill.maxIndex, scan.nBeams);
+    if (scan.ranges != NULL) {
         
-        // add each specified point of the scan to the mesh
-        // (add one because the first datum in the csv line is the time)
-        for (int i = minIndex + 1; i < maxIndex + 1; i++) {
-            
-            // get the coordinates
-            float px = ofToFloat(items[2 * i]); // millimeters
-            float py = ofToFloat(items[2 * i + 1]);
-            
-            // if a cull distance is provided, calculate the distance of this point to the origin
-            if (cullDistance != 0) {
-                double distance = ofVec2f(px, py).distance(ofVec2f(0, 0));
-                if (distance < abs(cullDistance)) continue;
-            }
+        // ranges are culled before they're converted, with an integer compare
+        const float* beamCos = linearRecording.getBeamCosines();
+        const float* beamSin = linearRecording.getBeamSines();
+        int32_t cull = abs(fill.cullDistance);
+        for (int i = max(fill.minIndex, 0); i < lastIndex; i++) {
             
-            // if time dependent, graph depth (pz) proportional to elapsed time; otherwise, graph with constant spacing (assume a new reading is taken every 100 ms)
-            float pz = (timeDependent) ? (timeNow * zScale) : ((float)nLinearScans / 10. * zScale);
+            int32_t r = scan.ranges[i]; // millimeters
+            if (r < cull) continue;
             
-            // add the vertex to the mesh and add the specified color
-            linearMesh.addVertex(ofVec3f(px, py, pz));
-            linearMesh.addColor(ofFloatColor(1));
+            float range = r;
+            vertices.push_back(ofVec3f(range * beamCos[i], range * beamSin[i], pz));
+            nAdded++;
+        }
+        return nAdded;
+    }
+    
+    for (int i = max(fill.minIndex, 0); i < lastIndex; i++) {
+        
+        // get the coordinates
+        float px = scan.x[i * scan.stride]; // millimeters
+        float py = scan.y[i * scan.stride];
+        
+        // if a cull distance is provided, calculate the distance of this point to the origin
+        if (fill.cullDistance != 0) {
+            double distance = ofVec2f(px, py).distance(ofVec2f(0, 0));
+            if (distance < abs(fill.cullDistance)) continue;
+        }
+        
+        // add the vertex
+        vertices.push_back(ofVec3f(px, py, pz));
+        nAdded++;
+    }
+    return nAdded;
+}
+
+// ---------------------------------------------------------------------
+
+void urgDisplay::updateLinearPlayback(float seconds) {
+    
+    if (!linearPlayback) {
+        if (linearPlaying) stopLinearPlayback();
+        return;
+    }
+    unsigned long nScans = linearRecording.getNumScans();
+    if (nScans == 0) return;
+    if (!linearPlaying) startLinearPlayback();
+    
+    // move the playhead, stopping at either end of the recording
+    bool forward = linearPlaybackSpeed >= 0;
+    linearPlayhead += seconds * 1000. * linearPlaybackSpeed;
+    linearPlayhead = max(linearPlayhead, linearRecording.getScanTime(0));
+    linearPlayhead = min(linearPlayhead, linearRecording.getScanTime(nScans - 1));
+    
+    // scans [begin, end) are in the window: those taken up to the playhead,
+    // no more than linearPlaybackScans of them and (if it's set) no more than
+    // linearPlaybackSeconds before it
+    unsigned long end = linearRecording.findScan(linearPlayhead);
+    while (end < nScans && linearRecording.getScanTime(end) <= linearPlayhead) end++;
+    unsigned long begin = (end > (unsigned long)linearPlaybackScans) ? end - linearPlaybackScans : 0;
+    if (linearPlaybackSeconds > 0) begin = max(begin, linearRecording.findScan(linearPlayhead - linearPlaybackSeconds * 1000.));
+    begin = min(begin, end);
+    
+    linearFill fill = { (int)begin, (int)end + 1, lastLinearFill.zScale, linearMinIndex, linearMaxIndex, linearCullDistance, lastLinearFill.timeDependent };
+    const linearFill& last = linearPlaybackFill;
+    bool sameFilter = fill.zScale == last.zScale && fill.minIndex == last.minIndex && fill.maxIndex == last.maxIndex && fill.timeDependent == last.timeDependent && fill.cullDistance == last.cullDistance;
+    
+    unsigned long cacheEnd = linearCacheStart + linearCache.size();
+    bool changed = !sameFilter;
+    
+    // a window that doesn't overlap the cached scans (the playhead jumped, or
+    // nothing is cached yet) starts over, with the depths counted from its start
+    if (end <= linearCacheStart || begin >= cacheEnd) {
+        changed = changed || !linearCache.empty();
+        linearCache.clear();
+        linearCacheValid.clear();
+        linearCacheVertices.clear();
+        linearMesh.clear();
+        linearCacheStart = begin;
+        linearAnchorScan = begin;
+        cacheEnd = begin;
+    }
+    
+    // drop the scans that left the window, from either end
+    size_t nFront = 0, nBack = 0;
+    while (linearCacheStart < begin) {
+        nFront += linearCacheVertices.front();
+        linearCache.pop_front();
+        linearCacheValid.pop_front();
+        linearCacheVertices.pop_front();
+        linearCacheStart++;
+    }
+    while (cacheEnd > end) {
+        nBack += linearCacheVertices.back();
+        linearCache.pop_back();
+        linearCacheValid.pop_back();
+        linearCacheVertices.pop_back();
+        cacheEnd--;
+    }
+    vector<ofVec3f>& vertices = linearMesh.getVertices();
+    if (nFront + nBack > 0) {
+        vertices.erase(vertices.begin(), vertices.begin() + nFront);
+        vertices.resize(vertices.size() - nBack);
+        changed = true;
+    }
+    
+    // depths far from the anchor lose precision: count them from the window's start again
+    float shift = linearPlaybackDepth(linearCacheStart, fill);
+    if (fabs(shift) > 1e6) {
+        for (size_t i = 0; i < vertices.size(); i++) vertices[i].z -= shift;
+        linearAnchorScan = linearCacheStart;
+        changed = true;
+    }
+    
+    // a new filter places every cached scan again
+    if (!sameFilter) {
+        vertices.clear();
+        for (size_t i = 0; i < linearCache.size(); i++) {
+            linearCacheVertices[i] = linearCacheValid[i] ? placeLinearScan(viewScan(linearCache[i]), linearPlaybackDepth(linearCacheStart + i, fill), fill, vertices) : 0;
         }
+    }
+    
+    // take the scans that entered the window, as far as they've been read
+    // (the rest are taken on a later frame rather than waited for)
+    while (cacheEnd < end) {
+        urgScan scan;
+        bool valid;
+        if (!linearPrefetcher.take(cacheEnd, scan, valid)) break;
+        linearCache.push_back(urgScan());
+        swap(linearCache.back(), scan);
+        linearCacheValid.push_back(valid);
+        linearCacheVertices.push_back(valid ? placeLinearScan(viewScan(linearCache.back()), linearPlaybackDepth(cacheEnd, fill), fill, vertices) : 0);
+        cacheEnd++;
+        changed = true;
+    }
+    if (linearCacheStart > begin) {
         
-        // increment scan number
-        nLinearScans++;
+        // scans entering at the front go before the window's other points
+        vector<ofVec3f> entered;
+        unsigned long first = linearCacheStart;
+        while (first > begin) {
+            urgScan scan;
+            bool valid;
+            if (!linearPrefetcher.take(first - 1, scan, valid)) break;
+            first--;
+            linearCache.push_front(urgScan());
+            swap(linearCache.front(), scan);
+            linearCacheValid.push_front(valid);
+            linearCacheVertices.push_front(0);
+        }
+        for (unsigned long i = first; i < linearCacheStart; i++) {
+            size_t c = i - first;
+            if (linearCacheValid[c]) linearCacheVertices[c] = placeLinearScan(viewScan(linearCache[c]), linearPlaybackDepth(i, fill), fill, entered);
+        }
+        if (first < linearCacheStart) changed = true;
+        vertices.insert(vertices.begin(), entered.begin(), entered.end());
+        linearCacheStart = first;
+    }
+    
+    // read on ahead, or toward the scans the window is still missing
+    if (cacheEnd < end) linearPrefetcher.seek(cacheEnd, true);
+    else if (linearCacheStart > begin) linearPrefetcher.seek(linearCacheStart - 1, false);
+    else if (forward) linearPrefetcher.seek(cacheEnd, true);
+    else linearPrefetcher.seek(linearCacheStart > 0 ? linearCacheStart - 1 : 0, false);
+    
+    linearPlaybackFill = fill;
+    if (!changed) return;
+    
+    linearMesh.getColors().resize(vertices.size(), ofFloatColor(1));
+    nLinearScans = 0;
+    for (size_t i = 0; i < linearCacheValid.size(); i++) {
+        if (linearCacheValid[i]) nLinearScans++;
     }
+    linearZOffset = linearPlaybackDepth(linearCacheStart, fill);
+    linearOctreeDirty = true;
+}
+
+// ---------------------------------------------------------------------
+
+float urgDisplay::linearPlaybackDepth(unsigned long i, const linearFill& fill) {
+    
+    // the spacing fillLinearMesh() uses: by time, or a scan every 100 ms
+    if (fill.timeDependent) return (linearRecording.getScanTime(i) - linearRecording.getScanTime(linearAnchorScan)) / 1000. * fill.zScale;
+    return ((double)i - (double)linearAnchorScan) / 10. * fill.zScale;
+}
+
+// ---------------------------------------------------------------------
+
+void urgDisplay::startLinearPlayback() {
+    
+    // start from the window's start scan, with nothing in the mesh
+    unsigned long nScans = linearRecording.getNumScans();
+    unsigned long start = min((unsigned long)max((int)linearStartScan, 0), nScans - 1);
+    linearCache.clear();
+    linearCacheValid.clear();
+    linearCacheVertices.clear();
+    nLinearScans = 0;
+    
+    // give back the memory of the whole window's points (and their octree,
+    // which playback draws without)
+    vector<ofVec3f>().swap(linearMesh.getVertices());
+    vector<ofFloatColor>().swap(linearMesh.getColors());
+    linearOctree.clear();
+    
+    linearCacheStart = start;
+    linearAnchorScan = start;
+    linearZOffset = 0;
+    linearPlayhead = linearRecording.getScanTime(start);
+    linearPlaybackFill = lastLinearFill;
+    linearPlaybackFill.minIndex = linearMinIndex;
+    linearPlaybackFill.maxIndex = linearMaxIndex;
+    linearPlaybackFill.cullDistance = linearCullDistance;
+    linearOctreeDirty = true;
+    
+    linearPrefetcher.setup(&linearRecording);
+    linearPrefetcher.seek(start, linearPlaybackSpeed >= 0);
+    linearPlaying = true;
+}
+
+// ---------------------------------------------------------------------
+
+void urgDisplay::closeLinearPlayback() {
+    
+    if (!linearPlaying) return;
+    linearPrefetcher.close();
+    linearPlaying = false;
+    linearZOffset = 0;
+}
+
+// ---------------------------------------------------------------------
+
+void urgDisplay::stopLinearPlayback() {
+    
+    closeLinearPlayback();
+    
+    // fill the whole window again
+    linearCache.clear();
+    linearCacheValid.clear();
+    linearCacheVertices.clear();
+    linearFilled = false;
+    updateLinearMesh(linearStartScan, linearEndScan, lastLinearFill.zScale, linearMinIndex, linearMaxIndex, lastLinearFill.timeDependent, linearCullDistance);
+}
+
+// ---------------------------------------------------------------------
+
+size_t urgDisplay::downsampleLinearMesh(float cellSize, urgVoxelMode mode) {
+    
+    linearOctreeDirty = true;
+    return urgVoxelDownsample(linearMesh, linearMesh, cellSize, mode);
 }
 
 // ---------------------------------------------------------------------
@@ -140,6 +589,7 @@ void urgDisplay::drawLinearMesh() {
     // update auto controls
     int key = getLKey();
     if (key == 's') linearAutoSlide = !linearAutoSlide;
+    if (key == 'p') linearPlayback = !linearPlayback;
     if (linearAutoSlide) linearSlide -= linearAutoSlideStep;
     
     // update manual controls
@@ -176,18 +626,35 @@ void urgDisplay::drawLinearMesh() {
     ofScale(1 - 2 * mirrorX, 1 - 2 * mirrorY, 1 - 2 * mirrorZ);
     ofScale(linearScale, linearScale, linearScale);
     
-    linearMesh.drawVertices();
+    // a playback window's first scan sits where a fill's would
+    if (linearZOffset != 0) ofTranslate(0, 0, -linearZOffset);
+    
+    // (a playback window changes nearly every frame, and is small enough to
+    // draw whole: rebuilding the octree for each frame would cost more than it saves)
+    if (linearLevelOfDetail && !linearPlaying) {
+        if (linearOctreeDirty) {
+            linearOctree.build(linearMesh);
+            linearOctreeDirty = false;
+        }
+        linearOctree.draw(linearPointBudget);
+    }
+    else {
+        linearMesh.drawVertices();
+    }
     ofPopMatrix();
     
 }
 
 // ---------------------------------------------------------------------
 
-void urgDisplay::loadSphericalData(string fileName) {
-    
-    ofFile file(fileName);
+bool urgDisplay::loadSphericalData(string fileName) {
     
-    sphericalBuffer = ofBuffer(file);
+    bool loaded = sphericalRecording.load(fileName);
+    sphericalScanCache.clear();
+    if (sphericalScanCacheMB > 0 && !sphericalScanCache.build(sphericalRecording, (size_t)sphericalScanCacheMB << 20)) {
+        ofLogNotice("urgDisplay") << fileName << " is too long to hold parsed; its scans are parsed at every fill";
+    }
+    return loaded;
 }
 
 // ---------------------------------------------------------------------
@@ -196,6 +663,9 @@ void urgDisplay::fillSphericalMesh(float speed, float period, float startingPeri
     
     // clear the existing mesh of any points
     sphericalMesh.clear();
+    sphericalOctreeDirty = true;
+    sphericalGridCells.clear();
+    sphericalGridRows = sphericalGridColumns = 0;
     
     // reset number of scans
     nSphericalScans = 0;
@@ -206,41 +676,35 @@ void urgDisplay::fillSphericalMesh(float speed, float period, float startingPeri
     // starting time of the first specified scan (seconds)
     float timeZero;
 
-    // find the first scan within this period
-    ofBuffer::Line it = sphericalBuffer.getLines().begin();
-    ofBuffer::Line end = sphericalBuffer.getLines().end();
-    while(it != end) {
-
-        string line = *it;
-        if (line.empty() == true) continue;
-        vector<string> items = ofSplitString(line, ",");
-        
-        float timeNow = ofToFloat(items[0]) / 1000.;
-        
-        if (timeNow * speed >= startingPeriod * period) {
-            timeZero = timeNow;
-            // break so iterator begins at the starting period
-            break;
-        }
-        
-        // increment iterator
-        ++it;
-    }
-    if (it == end) {
+    // scans come from the parsed rows, or (for a recording too long to hold
+    // parsed) straight from the recording
+    urgScanCache& cache = sphericalScanCache;
+    urgRecording& recording = sphericalRecording;
+    bool parsed = cache.isBuilt();
+    auto scanTime = [&](unsigned long s) { return parsed ? cache.getTime(s) : recording.getScanTime(s); };
+    
+    // find the first scan within this period with the index,
+    // then settle it with the same comparison the scans are filtered by
+    unsigned long nScans = recording.getNumScans();
+    unsigned long first = recording.findScan(startingPeriod * period / speed * 1000.);
+    while (first > 0 && (float)(scanTime(first - 1) / 1000.) * speed >= startingPeriod * period) first--;
+    while (first < nScans && (float)(scanTime(first) / 1000.) * speed < startingPeriod * period) first++;
+    
+    if (first >= nScans) {
         cout << "Desired interval cannot be set. Try setting to a lower startingPeriod. Exiting..." << endl;
         ofExit();
+        return;
     }
+    timeZero = scanTime(first) / 1000.;
     
-    // start adding points to the mesh and continue checking for an end condition
+    // choose the scans to include from their times alone
+    vector<unsigned long> scanIndices;
+    vector<float> scanTimes;
     float prevTime = -9999;
-    while (it != end) {
-        
-        string line = *it;
-        if (line.empty() == true) continue;
-        vector<string> items = ofSplitString(line, ",");
+    for (unsigned long s = first; s < nScans; s++) {
         
         // find current time
-        float timeNow = ofToFloat(items[0]) / 1000. - timeZero;
+        float timeNow = scanTime(s) / 1000. - timeZero;
         
         // check if end condition is met (scan has traversed nPeriods)
         if (timeNow * speed > (startingPeriod + nPeriods) * period) break;
@@ -248,47 +712,168 @@ void urgDisplay::fillSphericalMesh(float speed, float period, float startingPeri
         // check if scan is a duplicate
         if (cullDuplicateScans) {
             float diff = timeNow - prevTime;
-            if (diff <= 0.05) {
-                ++it;
-                continue;
-            }
+            if (diff <= 0.05) continue;
         }
         
-        // add points to the mesh
-        for (int i = minIndex + 1; i < maxIndex + 1; i++) {
-            
-            // get the coordinates
-            float px = ofToFloat(items[2 * i]); // millimeters
-            float py = ofToFloat(items[2 * i + 1]);
+        scanIndices.push_back(s);
+        scanTimes.push_back(timeNow);
+        prevTime = timeNow;
+    }
+    
+    // rotating each point about the z axis to orient it upwards, then by the realignment angle
+    // (which stretches or compresses each chunk (period) of data) only depends on the beam,
+    // so it's one precomputed rotation per beam
+    minIndex = max(minIndex, 0);
+    vector<float> beamCos(max(maxIndex, 0));
+    vector<float> beamSin(max(maxIndex, 0));
+    for (int i = minIndex; i < maxIndex; i++) {
+        float alignmentAmt = (float)i / 682. * alignmentAngle;
+        beamCos[i] = cos((180. + alignmentAmt) * DEG_TO_RAD);
+        beamSin[i] = sin((180. + alignmentAmt) * DEG_TO_RAD);
+    }
+    double cullSquared = (double)cullDistance * cullDistance;
+    int32_t cullRange = abs(cullDistance);
+    const float* rangeCos = parsed ? cache.getBeamCosines() : recording.getBeamCosines();
+    const float* rangeSin = parsed ? cache.getBeamSines() : recording.getBeamSines();
+    
+    // transform the scans in parallel (nothing is read from the file when
+    // they're parsed), each thread into its own block of points
+    int nChunks = urgNumChunks(scanIndices.size(), 16);
+    vector<vector<ofVec3f> > chunkPoints(nChunks);
+    vector<vector<uint32_t> > chunkCells(nChunks);
+    vector<unsigned long> chunkScans(nChunks, 0);
+    int nColumns = max(maxIndex - minIndex, 0);
+    
+    urgParallelFor(scanIndices.size(), [&](int chunk, size_t begin, size_t end) {
+        
+        vector<ofVec3f>& points = chunkPoints[chunk];
+        vector<uint32_t>& cells = chunkCells[chunk];
+        points.reserve((end - begin) * nColumns);
+        cells.reserve((end - begin) * nColumns);
+        urgScan read;
+        
+        for (size_t s = begin; s < end; s++) {
             
-            // if a cull distance is provided, calculate the distance of this point to the origin
-            if (cullDistance != 0) {
-                double distance = ofVec2f(px, py).distance(ofVec2f(0, 0));
-                if (distance < abs(cullDistance)) continue;
+            unsigned long scan = scanIndices[s];
+            scanView view;
+            if (parsed) {
+                if (!cache.isValid(scan)) continue;
+                view = viewScan(cache, scan);
             }
+            else {
+                if (recording.readScan(scan, read, false) == URG_PARSE_MALFORMED) continue;
+                view = viewScan(read);
+            }
+            int lastIndex = min(maxIndex, view.nBeams);
             
-            // rotate point about z axis to orient it upwards
-            ofVec3f point(px, py, 0);
-            point.rotate(180, ofVec3f(0, 0, 1));
-            
-            // apply the realignment angle to stretch or compress each chunk (period) of data
-            float alignmentAmt = (float)i / 682. * alignmentAngle;
-            point.rotate(alignmentAmt, ofVec3f(0, 0, 1));
-            
-            // rotate point about the y axis an amount proportional to the elapsed time and speed
-            float rotationAmt = timeNow * speed;
+            // rotate points about the y axis an amount proportional to the elapsed time and speed
+            float rotationAmt = scanTimes[s] * speed;
             if (clockwise) rotationAmt *= -1.;
-            point.rotate(rotationAmt, ofVec3f(0, 1, 0));
+            float cosY = cos(rotationAmt * DEG_TO_RAD);
+            float sinY = sin(rotationAmt * DEG_TO_RAD);
             
-            // add point to the mesh
-            sphericalMesh.addVertex(point);
-            sphericalMesh.addColor(ofFloatColor(1));
+            // add points to the mesh; ranges are culled before they're converted, with an integer compare
+            if (view.ranges != NULL) {
+                const int32_t* ranges = view.ranges;
+                for (int i = minIndex; i < lastIndex; i++) {
+                    
+                    int32_t r = ranges[i]; // millimeters
+                    if (r < cullRange) continue;
+                    
+                    float range = r;
+                    float px = range * rangeCos[i];
+                    float py = range * rangeSin[i];
+                    float x = px * beamCos[i] - py * beamSin[i];
+                    float y = px * beamSin[i] + py * beamCos[i];
+                    points.push_back(ofVec3f(x * cosY, y, -x * sinY));
+                    cells.push_back(s * nColumns + i - minIndex);
+                }
+                chunkScans[chunk]++;
+                continue;
+            }
+            
+            for (int i = minIndex; i < lastIndex; i++) {
+                
+                // get the coordinates
+                float px = view.x[i * view.stride]; // millimeters
+                float py = view.y[i * view.stride];
+                
+                // if a cull distance is provided, discard points closer than it to the origin
+                if (cullDistance != 0 && (double)px * px + (double)py * py < cullSquared) continue;
+                
+                // rotate about z for the beam, then about y for the scan
+                float x = px * beamCos[i] - py * beamSin[i];
+                float y = px * beamSin[i] + py * beamCos[i];
+                points.push_back(ofVec3f(x * cosY, y, -x * sinY));
+                cells.push_back(s * nColumns + i - minIndex);
+            }
+            chunkScans[chunk]++;
         }
-        
-        prevTime = timeNow;
-        nSphericalScans++;
-        ++it;
+    }, 16);
+    
+    // copy the blocks into the mesh in scan order
+    size_t nPoints = 0;
+    for (int c = 0; c < nChunks; c++) nPoints += chunkPoints[c].size();
+    
+    vector<ofVec3f>& vertices = sphericalMesh.getVertices();
+    vertices.reserve(nPoints);
+    sphericalGridCells.reserve(nPoints);
+    for (int c = 0; c < nChunks; c++) {
+        vertices.insert(vertices.end(), chunkPoints[c].begin(), chunkPoints[c].end());
+        vector<ofVec3f>().swap(chunkPoints[c]);
+        sphericalGridCells.insert(sphericalGridCells.end(), chunkCells[c].begin(), chunkCells[c].end());
+        vector<uint32_t>().swap(chunkCells[c]);
+        nSphericalScans += chunkScans[c];
+    }
+    sphericalMesh.getColors().assign(nPoints, ofFloatColor(1));
+    sphericalGridRows = scanIndices.size();
+    sphericalGridColumns = nColumns;
+}
+
+// ---------------------------------------------------------------------
+
+size_t urgDisplay::removeSphericalOutliers(float stdDevs, int radius) {
+    
+    vector<ofVec3f>& vertices = sphericalMesh.getVertices();
+    if (sphericalGridCells.size() != vertices.size()) {
+        ofLogWarning("urgDisplay") << "can't remove outliers: the spherical mesh isn't as it was filled";
+        return 0;
+    }
+    
+    // the index of the point in each grid cell
+    vector<int32_t> cells((size_t)sphericalGridRows * sphericalGridColumns, -1);
+    for (size_t p = 0; p < sphericalGridCells.size(); p++) cells[sphericalGridCells[p]] = p;
+    
+    vector<uint8_t> outliers;
+    size_t nOutliers = urgFindOutliers(vertices.data(), vertices.size(), cells.data(), sphericalGridRows, sphericalGridColumns, radius, stdDevs, outliers);
+    if (nOutliers == 0) return 0;
+    
+    // keep the rest in order, with their colors and cells
+    vector<ofFloatColor>& colors = sphericalMesh.getColors();
+    bool hasColors = colors.size() == vertices.size();
+    size_t nKept = 0;
+    for (size_t p = 0; p < vertices.size(); p++) {
+        if (outliers[p]) continue;
+        vertices[nKept] = vertices[p];
+        if (hasColors) colors[nKept] = colors[p];
+        sphericalGridCells[nKept] = sphericalGridCells[p];
+        nKept++;
     }
+    vertices.resize(nKept);
+    if (hasColors) colors.resize(nKept);
+    sphericalGridCells.resize(nKept);
+    
+    sphericalOctreeDirty = true;
+    return nOutliers;
+}
+
+// ---------------------------------------------------------------------
+
+size_t urgDisplay::downsampleSphericalMesh(float cellSize, urgVoxelMode mode) {
+    
+    sphericalOctreeDirty = true;
+    sphericalGridCells.clear();
+    return urgVoxelDownsample(sphericalMesh, sphericalMesh, cellSize, mode);
 }
 
 // ---------------------------------------------------------------------
@@ -337,38 +922,42 @@ void urgDisplay::drawSphericalMesh(bool cameraOn) {
     
     ofRotateY(sphericalRotationLerp);
     
-    sphericalMesh.drawVertices();
+    if (sphericalLevelOfDetail) {
+        if (sphericalOctreeDirty) {
+            sphericalOctree.build(sphericalMesh);
+            sphericalOctreeDirty = false;
+        }
+        sphericalOctree.draw(sphericalPointBudget);
+    }
+    else {
+        sphericalMesh.drawVertices();
+    }
     ofPopMatrix();
     
     if (cameraOn) easyCam.end();
 }
 
 // ---------------------------------------------------------------------
-void urgDisplay::export_pointcloud(string _filename, ofMesh mesh, bool type_ply, bool type_csv){
+void urgDisplay::export_pointcloud(string _filename, const ofMesh& mesh, bool type_ply, bool type_csv, bool binary, bool type_raw){
     
     _filename=_filename.substr(0,_filename.size()-4);
-    // Create both, write to either or both
-    ofFile output_ply(_filename+".ply", ofFile::WriteOnly);
-    ofFile output_csv(_filename+".csv", ofFile::WriteOnly);
-    
-    if (type_ply){
-        // make PLY header
-        output_ply << "ply" << endl;
-        output_ply << "format ascii 1.0" << endl;
-        output_ply << "element vertex " << sphericalMesh.getVertices().size() << endl;
-        output_ply << "property float x" << endl;
-        output_ply << "property float y" << endl;
-        output_ply << "property float z" << endl;
-        output_ply << "end_header" << endl;
-    }
-    for (auto point : mesh.getVertices()){
-        // save 3D point out to ply or csv
-        if (type_csv)
-            output_csv << ofToString(point.x) << "," << ofToString(point.y) << "," << ofToString(point.z) << ",";
-        if (type_ply)
-            output_ply << ofToString(point.x) << " " << ofToString(point.y) << " " << ofToString(point.z) << endl;
+    const vector<ofVec3f>& points = mesh.getVertices();
+    
+    // write to any of them
+    if (type_ply) {
+        urgExportType type = binary ? URG_EXPORT_PLY_BINARY : URG_EXPORT_PLY_ASCII;
+        urgExportPoints(_filename + "." + urgExportExtension(type), points.data(), points.size(), type);
     }
+    if (type_csv) urgExportPoints(_filename + ".csv", points.data(), points.size(), URG_EXPORT_CSV);
+    if (type_raw) urgExportPoints(_filename + ".raw", points.data(), points.size(), URG_EXPORT_RAW);
+}
+
+// ---------------------------------------------------------------------
+
+bool urgDisplay::convertToCsv(string fileName) {
     
+    string csvFileName = fileName.substr(0, fileName.find_last_of('.')) + ".csv";
+    return urgConvertToCsv(fileName, csvFileName);
 }
 
 // ---------------------------------------------------------------------
@@ -10,6 +10,12 @@
 #define __urg_capture_display__urgDisplay__
 
 #include "ofMain.h"
+#include "urgRecording.h"
+#include "urgVoxelGrid.h"
+#include "urgOutlierFilter.h"
+#include "urgOctree.h"
+#include "urgScanPrefetcher.h"
+#include "urgScanCache.h"
 
 class urgDisplay {
     
@@ -24,13 +30,19 @@ public:
     // holds linear mesh
     ofMesh linearMesh;
     
-    // load data from a csv into a buffer in the following format
+    // load data from a csv in the following format
     //      time   x0  y0  x1  y1  x2  y2 ...
-    void loadLinearData(string fileName);
+    // or from a binary recording (see urgFormat.h); false if it can't be read
+    bool loadLinearData(string fileName);
     
-    ofBuffer linearBuffer;
+    urgRecording linearRecording;
     unsigned long nLinearScans;
     
+    // most memory (MB) the parsed scans of a linear recording can take; a
+    // recording that fits is parsed once when it's loaded, and one that
+    // doesn't (or any, with 0) is parsed as fills need its scans
+    int linearScanCacheMB = 2048;
+    
     // fill the linear mesh with points according to the following parameters
     void fillLinearMesh(int startScan = 0, int endScan = -1, int zScale = 300, int minIndex = 0, int maxIndex = 682, bool timeDependent = false, int cullDistance = 265, ofColor color = ofColor(255));
     /*  
@@ -44,6 +56,19 @@ public:
         color           color of points
      */
     
+    // same as fillLinearMesh(), but reuses the scans parsed by the last fill:
+    // moving the ends of the window only reads the scans that entered it and
+    // only adds or trims their points, and changing the beam range or cull
+    // distance rebuilds the mesh from the parsed scans without reading the file
+    void updateLinearMesh(int startScan = 0, int endScan = -1, int zScale = 300, int minIndex = 0, int maxIndex = 682, bool timeDependent = false, int cullDistance = 265, ofColor color = ofColor(255));
+    
+    // update the linear mesh from the window parameters below (call every frame)
+    void updateLinearWindow();
+    
+    // keep one point per cellSize (mm) cell of the linear mesh (see urgVoxelGrid.h);
+    // returns the number of points kept
+    size_t downsampleLinearMesh(float cellSize, urgVoxelMode mode = URG_VOXEL_CENTROID);
+    
     void drawLinearMesh();
     
     ofParameterGroup linearParams;
@@ -60,20 +85,63 @@ public:
     ofParameter<bool> mirrorX;
     ofParameter<bool> mirrorY;
     ofParameter<bool> mirrorZ;
+    ofParameter<bool> linearLevelOfDetail;  // draw through linearOctree
+    ofParameter<int> linearPointBudget;     // most points to draw per frame with level of detail
+    
+    // level of detail index of the linear mesh, rebuilt when the mesh changes
+    urgOctree linearOctree;
+    bool linearOctreeDirty = true;
+    
+    ofParameterGroup linearWindowParams;
+    ofParameter<int> linearStartScan;
+    ofParameter<int> linearEndScan;
+    ofParameter<int> linearMinIndex;
+    ofParameter<int> linearMaxIndex;
+    ofParameter<int> linearCullDistance;
     
     float linearSlideLerp;
     float linearSlideLerpAmt = 0.05;
     
     
+    // ---------------------------
+    // ----- LINEAR PLAYBACK -----
+    // ---------------------------
+    
+    // while linearPlayback is set, the linear mesh holds only a sliding window
+    // of the recording instead of the whole of it: the scans up to a playhead
+    // that moves through the recording at linearPlaybackSpeed times real time
+    // (negative plays in reverse), starting from the window's start scan
+    // scans are placed by the same rules as fillLinearMesh() (as if the window's
+    // first scan was startScan), read ahead on a background thread, and dropped
+    // once they leave the window, so memory stays bounded however long the
+    // recording is; unsetting linearPlayback goes back to the whole window
+    // the window is drawn whole, without level of detail
+    void updateLinearPlayback(float seconds);  // seconds since the last update (call every frame)
+    
+    ofParameterGroup linearPlaybackParams;
+    ofParameter<bool> linearPlayback;
+    ofParameter<float> linearPlaybackSpeed;
+    ofParameter<int> linearPlaybackScans;       // most scans in the window
+    ofParameter<float> linearPlaybackSeconds;   // most seconds of scans in the window (0 for no limit)
+    
+    // time (ms) in the recording the playback is at
+    double linearPlayhead = 0;
+    
+    
     // ---------------------------
     // ----- SPHERICAL MESH ------
     // ---------------------------
     
     ofMesh sphericalMesh;
     
-    void loadSphericalData(string fileName);
+    // load data from a csv or binary recording (same formats as linear data)
+    bool loadSphericalData(string fileName);
     
-    ofBuffer sphericalBuffer;
+    // most memory (MB) the parsed scans of a spherical recording can take
+    // (as linearScanCacheMB: one that doesn't fit is parsed at every fill)
+    int sphericalScanCacheMB = 2048;
+    
+    urgRecording sphericalRecording;
     unsigned long nSphericalScans;
     
     void fillSphericalMesh(float speed = 225./64., float period = 180, float startingPeriod = 0, float nPeriods = 1, int minIndex = 0, int maxIndex = 682, bool clockwise = true, int cullDistance = 265, float alignmentAngle = 0, ofColor color = ofColor(255), bool cullDuplicateScans = true);
@@ -90,6 +158,17 @@ public:
         cullDoubleScans scans are sometimes output by the sensor twice in a row, within 30 ms of each other; this will cull doubles
      */
     
+    // drop the points of the spherical mesh whose distances to their neighbours
+    // on the scan x beam grid are more than stdDevs standard deviations above
+    // the mean (see urgOutlierFilter.h); neighbours are up to radius beams and
+    // scans away; call after fillSphericalMesh() and before downsampling
+    // returns the number of points dropped
+    size_t removeSphericalOutliers(float stdDevs = 2, int radius = 1);
+    
+    // keep one point per cellSize (mm) cell of the spherical mesh (see urgVoxelGrid.h);
+    // returns the number of points kept
+    size_t downsampleSphericalMesh(float cellSize, urgVoxelMode mode = URG_VOXEL_CENTROID);
+    
     void drawSphericalMesh(bool cameraOn = false);
     
     ofEasyCam easyCam;
@@ -105,6 +184,12 @@ public:
     ofParameter<bool> flipX;
     ofParameter<bool> flipY;
     ofParameter<bool> flipZ;
+    ofParameter<bool> sphericalLevelOfDetail;   // draw through sphericalOctree
+    ofParameter<int> sphericalPointBudget;      // most points to draw per frame with level of detail
+    
+    // level of detail index of the spherical mesh, rebuilt when the mesh changes
+    urgOctree sphericalOctree;
+    bool sphericalOctreeDirty = true;
     
     float sphericalRotationLerp;
     float sphericalRotationLerpAmt = 0.05;
@@ -120,7 +205,98 @@ public:
     int getSKey();
     
     string filename;
-    void export_pointcloud(string _filename, ofMesh mesh, bool type_ply=true, bool type_csv=false);
+    // export a mesh's points next to _filename (its extension is replaced):
+    // PLY (binary unless binary is false), csv, and/or raw float32 x y z
+    void export_pointcloud(string _filename, const ofMesh& mesh, bool type_ply=true, bool type_csv=false, bool binary=true, bool type_raw=false);
+    
+    // convert a binary recording to the csv layout, next to the original file
+    bool convertToCsv(string fileName);
+    
+private:
+    
+    // parameters of the last linear fill
+    struct linearFill {
+        int startScan, endScan, zScale, minIndex, maxIndex, cullDistance;
+        bool timeDependent;
+    };
+    linearFill lastLinearFill = { 0, -1, 300, 0, 682, 265, false };
+    
+    // scans [linearCacheStart, linearCacheStart + linearCacheValid.size())
+    // of the linear recording are in the window, and whether each was read;
+    // linearCache holds them (malformed ones empty) unless they're in
+    // linearScanCache, and while playing back
+    deque<urgScan> linearCache;
+    deque<bool> linearCacheValid;
+    unsigned long linearCacheStart = 0;
+    
+    // number of mesh vertices each cached scan added
+    deque<int> linearCacheVertices;
+    
+    // starting time of the first valid scan in the window (seconds)
+    float linearTimeZero;
+    
+    // whether the mesh and cache hold a fill
+    bool linearFilled = false;
+    
+    // every scan of each recording, parsed once when it's loaded (if it fits)
+    urgScanCache linearScanCache;
+    urgScanCache sphericalScanCache;
+    
+    // parse scans [begin, end) of the linear recording
+    void readLinearScans(unsigned long begin, unsigned long end, vector<urgScan>& scans, vector<bool>& valid);
+    
+    // whether the window's scans are read from linearScanCache
+    bool isLinearParsed();
+    
+    // a scan's time and beams, wherever they're held: ranges (mm), or x and
+    // y (mm) every stride floats
+    struct scanView {
+        double time;
+        int nBeams;
+        const int32_t* ranges;
+        const float* x;
+        const float* y;
+        int stride;
+    };
+    static scanView viewScan(const urgScan& scan);
+    static scanView viewScan(urgScanCache& cache, unsigned long i);
+    
+    // scan i of the window
+    scanView viewLinearScan(unsigned long i);
+    
+    // add the points of scan i of the window to the linear mesh; returns the number added
+    int addLinearScan(unsigned long i, const linearFill& fill);
+    
+    // add the points of a scan at depth pz (mm) to vertices; returns the number added
+    int placeLinearScan(const scanView& scan, float pz, const linearFill& fill, vector<ofVec3f>& vertices);
+    
+    // whether the linear cache and mesh hold a playback window
+    bool linearPlaying = false;
+    
+    // reads the scans playback reaches next
+    urgScanPrefetcher linearPrefetcher;
+    
+    // placement of the playback window's scans: depths count from the anchor
+    // scan, and the mesh is drawn linearZOffset back so the window's first
+    // scan is at depth 0, as in a fill
+    linearFill linearPlaybackFill;
+    unsigned long linearAnchorScan = 0;
+    float linearZOffset = 0;
+    
+    // depth (mm) of scan i of the playback window
+    float linearPlaybackDepth(unsigned long i, const linearFill& fill);
+    
+    // start a playback window at the window's start scan, and stop it
+    // (stopLinearPlayback() also fills the whole window again)
+    void startLinearPlayback();
+    void closeLinearPlayback();
+    void stopLinearPlayback();
+    
+    // grid cell (scan * sphericalGridColumns + beam) of each spherical mesh
+    // vertex, from the last fill; empty once the mesh is downsampled
+    vector<uint32_t> sphericalGridCells;
+    int sphericalGridRows = 0;
+    int sphericalGridColumns = 0;
     
 };
 
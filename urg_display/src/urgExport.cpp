@@ -0,0 +1,101 @@
+//
+//  urgExport.cpp
+//  urg_display
+//
+//  Writes point clouds to disk: binary or ascii PLY, the csv layout the
+//  display has always exported, or a raw dump of float32 x/y/z triples.
+//  Points are written straight from the caller's array in large blocks,
+//  and the text formats are built in parallel.
+//
+
+#include "urgExport.h"
+#include "urgParallel.h"
+
+// points written per block (binary) or formatted per thread (text)
+#define URG_EXPORT_BLOCK_POINTS (1 << 16)
+
+string urgExportExtension(urgExportType type) {
+    
+    switch (type) {
+        case URG_EXPORT_PLY_BINARY:
+        case URG_EXPORT_PLY_ASCII:  return "ply";
+        case URG_EXPORT_CSV:        return "csv";
+        case URG_EXPORT_RAW:        return "raw";
+    }
+    return "";
+}
+
+// ---------------------------------------------------------------------
+
+// append points [begin, end) as text
+static void formatPoints(string& text, const ofVec3f* points, size_t begin, size_t end, bool csv) {
+    
+    // (%g prints the same digits as ofToString)
+    const char* format = csv ? "%g,%g,%g," : "%g %g %g\n";
+    char line[64];
+    for (size_t i = begin; i < end; i++) {
+        int n = snprintf(line, sizeof(line), format, points[i].x, points[i].y, points[i].z);
+        text.append(line, n);
+    }
+}
+
+// ---------------------------------------------------------------------
+
+bool urgExportPoints(string fileName, const ofVec3f* points, size_t n, urgExportType type) {
+    
+    ofFile out(fileName, ofFile::WriteOnly, true);
+    if (!out.is_open()) {
+        ofLogError("urgExport") << "could not open " << fileName;
+        return false;
+    }
+    
+    if (type == URG_EXPORT_PLY_BINARY || type == URG_EXPORT_PLY_ASCII) {
+        
+        // make PLY header
+        string header = "ply\n";
+        header += (type == URG_EXPORT_PLY_BINARY) ? "format binary_little_endian 1.0\n" : "format ascii 1.0\n";
+        header += "element vertex " + ofToString(n) + "\n";
+        header += "property float x\n";
+        header += "property float y\n";
+        header += "property float z\n";
+        header += "end_header\n";
+        out.write(header.data(), header.size());
+    }
+    
+    if (type == URG_EXPORT_PLY_BINARY || type == URG_EXPORT_RAW) {
+        
+        // an ofVec3f is three packed floats, so the points go out as they are
+        for (size_t i = 0; i < n; i += URG_EXPORT_BLOCK_POINTS) {
+            size_t nBlock = min((size_t)URG_EXPORT_BLOCK_POINTS, n - i);
+            out.write((const char*)&points[i], nBlock * sizeof(ofVec3f));
+        }
+    }
+    else {
+        
+        // format one block per thread at a time, writing the blocks in order
+        bool csv = (type == URG_EXPORT_CSV);
+        vector<string> texts(urgNumThreads());
+        size_t batchPoints = texts.size() * URG_EXPORT_BLOCK_POINTS;
+        
+        for (size_t batch = 0; batch < n; batch += batchPoints) {
+            
+            size_t nBatch = min(batchPoints, n - batch);
+            size_t nBlocks = (nBatch + URG_EXPORT_BLOCK_POINTS - 1) / URG_EXPORT_BLOCK_POINTS;
+            urgParallelFor(nBlocks, [&](int chunk, size_t begin, size_t end) {
+                for (size_t b = begin; b < end; b++) {
+                    size_t first = batch + b * URG_EXPORT_BLOCK_POINTS;
+                    texts[b].clear();
+                    formatPoints(texts[b], points, first, min(first + URG_EXPORT_BLOCK_POINTS, n), csv);
+                }
+            });
+            for (size_t b = 0; b < nBlocks; b++) out.write(texts[b].data(), texts[b].size());
+        }
+    }
+    
+    if (!out.good()) {
+        ofLogError("urgExport") << "could not write " << fileName;
+        return false;
+    }
+    ofLogNotice("urgExport") << "exported " << n << " points to " << fileName;
+    return true;
+}
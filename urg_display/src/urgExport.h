@@ -0,0 +1,29 @@
+//
+//  urgExport.h
+//  urg_display
+//
+//  Writes point clouds to disk: binary or ascii PLY, the csv layout the
+//  display has always exported, or a raw dump of float32 x/y/z triples.
+//  Points are written straight from the caller's array in large blocks,
+//  and the text formats are built in parallel.
+//
+
+#ifndef __urg_display__urgExport__
+#define __urg_display__urgExport__
+
+#include "ofMain.h"
+
+enum urgExportType {
+    URG_EXPORT_PLY_BINARY = 0,  // binary little endian PLY
+    URG_EXPORT_PLY_ASCII = 1,   // ascii PLY, one "x y z" line per point
+    URG_EXPORT_CSV = 2,         // "x,y,z," for every point, on one line
+    URG_EXPORT_RAW = 3          // float32 x y z per point, no header
+};
+
+// file extension for an export type (without the dot)
+string urgExportExtension(urgExportType type);
+
+// write n points (millimeters) to a file; returns false if it can't be written
+bool urgExportPoints(string fileName, const ofVec3f* points, size_t n, urgExportType type);
+
+#endif /* defined(__urg_display__urgExport__) */
@@ -0,0 +1,157 @@
+//
+//  urgMappedFile.cpp
+//  urg_capture_display
+//
+//  Read-only memory mapping of a recording, so scans can be read straight
+//  from the file's pages instead of a copy of the whole file in memory.
+//
+
+#include "urgMappedFile.h"
+
+#ifndef TARGET_WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// pages are released in windows of this size once the reader has moved past them
+#define URG_RELEASE_WINDOW (32 << 20)
+
+urgMappedFile::urgMappedFile() {
+}
+
+// ---------------------------------------------------------------------
+
+urgMappedFile::~urgMappedFile() {
+
+    close();
+}
+
+// ---------------------------------------------------------------------
+
+bool urgMappedFile::open(string fileName) {
+
+    close();
+
+    string path = ofToDataPath(fileName, true);
+
+#ifdef TARGET_WIN32
+
+    buffer = ofBufferFromFile(path, true);
+    data = buffer.getData();
+    length = buffer.size();
+    return true;
+
+#else
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        ofLogError("urgMappedFile") << "could not open " << path;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ofLogError("urgMappedFile") << "could not read the size of " << path;
+        ::close(fd);
+        return false;
+    }
+
+    // an empty file has nothing to map
+    length = info.st_size;
+    if (length == 0) {
+        ::close(fd);
+        return true;
+    }
+
+    void* mapped = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+
+    if (mapped == MAP_FAILED) {
+        ofLogError("urgMappedFile") << "could not map " << path;
+        length = 0;
+        return false;
+    }
+
+    data = (const char*)mapped;
+    releasedOffset = 0;
+    adviseSequential();
+    return true;
+
+#endif
+}
+
+// ---------------------------------------------------------------------
+
+void urgMappedFile::close() {
+
+#ifdef TARGET_WIN32
+    buffer.clear();
+#else
+    if (data != NULL) munmap((void*)data, length);
+#endif
+
+    data = NULL;
+    length = 0;
+    releasedOffset = 0;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgMappedFile::isOpen() {
+    return data != NULL;
+}
+
+// ---------------------------------------------------------------------
+
+const char* urgMappedFile::getData() {
+    return data;
+}
+
+// ---------------------------------------------------------------------
+
+size_t urgMappedFile::size() {
+    return length;
+}
+
+// ---------------------------------------------------------------------
+
+void urgMappedFile::adviseSequential() {
+
+#ifndef TARGET_WIN32
+    if (data != NULL) madvise((void*)data, length, MADV_SEQUENTIAL);
+#endif
+}
+
+// ---------------------------------------------------------------------
+
+void urgMappedFile::adviseRandom() {
+
+#ifndef TARGET_WIN32
+    if (data != NULL) madvise((void*)data, length, MADV_RANDOM);
+#endif
+}
+
+// ---------------------------------------------------------------------
+
+void urgMappedFile::releaseBefore(size_t offset) {
+
+#ifndef TARGET_WIN32
+    if (data == NULL) return;
+
+    // reading went backwards; released pages will be faulted back in
+    if (offset < releasedOffset) {
+        releasedOffset = offset - offset % URG_RELEASE_WINDOW;
+        return;
+    }
+
+    if (offset - releasedOffset < URG_RELEASE_WINDOW) return;
+
+    // release whole windows (window size is a multiple of the page size)
+    size_t end = offset - offset % URG_RELEASE_WINDOW;
+    madvise((void*)(data + releasedOffset), end - releasedOffset, MADV_DONTNEED);
+    releasedOffset = end;
+#endif
+}
@@ -0,0 +1,55 @@
+//
+//  urgMappedFile.h
+//  urg_capture_display
+//
+//  Read-only memory mapping of a recording, so scans can be read straight
+//  from the file's pages instead of a copy of the whole file in memory.
+//
+
+#ifndef __urg_capture_display__urgMappedFile__
+#define __urg_capture_display__urgMappedFile__
+
+#include "ofMain.h"
+
+class urgMappedFile {
+
+public:
+
+    urgMappedFile();
+    ~urgMappedFile();
+
+    bool open(string fileName);
+    void close();
+    bool isOpen();
+
+    const char* getData();
+    size_t size();
+
+    // tell the os how the mapping is about to be read
+    void adviseSequential();
+    void adviseRandom();
+
+    // while streaming, hand back pages that lie before offset; they're read
+    // back in from the file if they're needed again
+    void releaseBefore(size_t offset);
+
+private:
+
+    // a mapping can't be copied
+    urgMappedFile(const urgMappedFile&);
+    urgMappedFile& operator=(const urgMappedFile&);
+
+    const char* data = NULL;
+    size_t length = 0;
+
+    // pages before this offset have been released
+    size_t releasedOffset = 0;
+
+#ifdef TARGET_WIN32
+    // no mmap: fall back to reading the whole file
+    ofBuffer buffer;
+#endif
+
+};
+
+#endif /* defined(__urg_capture_display__urgMappedFile__) */
@@ -0,0 +1,245 @@
+//
+//  urgOctree.cpp
+//  urg_display
+//
+//  Level of detail for drawing meshes too big to draw whole every frame.
+//  Each node of the octree holds up to nodeCapacity points spread through
+//  its cube and hands the rest down to its children, so the nodes near the
+//  root are a coarse version of the cloud and deeper nodes fill in detail.
+//  The points are reordered so that every node's points are contiguous and
+//  sit in one vbo; a frame draws the nodes in view, largest on screen
+//  first, until they're fine enough for the screen or the point budget is
+//  spent.
+//
+
+#include "urgOctree.h"
+#include <queue>
+
+void urgOctree::build(const ofMesh& mesh, int nodeCapacity, int maxDepth) {
+
+    clear();
+    capacity = max(nodeCapacity, 1);
+    depthLimit = max(maxDepth, 0);
+
+    const vector<ofVec3f>& meshPoints = mesh.getVertices();
+    size_t n = meshPoints.size();
+    if (n == 0) return;
+
+    // the cube around every point
+    ofVec3f low = meshPoints[0];
+    ofVec3f high = meshPoints[0];
+    for (size_t i = 1; i < n; i++) {
+        const ofVec3f& p = meshPoints[i];
+        low.x = min(low.x, p.x);    high.x = max(high.x, p.x);
+        low.y = min(low.y, p.y);    high.y = max(high.y, p.y);
+        low.z = min(low.z, p.z);    high.z = max(high.z, p.z);
+    }
+    float size = max(max(high.x - low.x, high.y - low.y), high.z - low.z);
+    size = max(size * 1.0001f, 1e-3f);
+
+    // sort point indices into nodes
+    source = &meshPoints;
+    order.resize(n);
+    for (size_t i = 0; i < n; i++) order[i] = i;
+    scratch.resize(n);
+    buildNode(0, n, low, size, 0);
+    source = NULL;
+
+    // points (and colors) in node order
+    const vector<ofFloatColor>& meshColors = mesh.getColors();
+    points.resize(n);
+    for (size_t i = 0; i < n; i++) points[i] = meshPoints[order[i]];
+    if (meshColors.size() == n) {
+        colors.resize(n);
+        for (size_t i = 0; i < n; i++) colors[i] = meshColors[order[i]];
+    }
+    vector<uint32_t>().swap(order);
+    vector<uint32_t>().swap(scratch);
+
+    vboDirty = true;
+}
+
+// ---------------------------------------------------------------------
+
+int urgOctree::buildNode(size_t begin, size_t end, ofVec3f corner, float size, int depth) {
+
+    int index = nodes.size();
+    nodes.push_back(node());
+    node& self = nodes.back();
+    self.corner = corner;
+    self.size = size;
+    self.first = begin;
+    for (int c = 0; c < 8; c++) self.children[c] = -1;
+
+    size_t n = end - begin;
+    if (n <= capacity || depth >= depthLimit) {
+        self.count = n;
+        return index;
+    }
+
+    // keep an even stride through the points (they're in scan order, so this
+    // spreads the node's points over every scan in it), and move the rest to the back
+    size_t kept = 0;
+    size_t passed = 0;
+    for (size_t i = 0; i < n; i++) {
+        if ((i + 1) * capacity / n > i * capacity / n) order[begin + kept++] = order[begin + i];
+        else scratch[passed++] = order[begin + i];
+    }
+    self.count = kept;
+
+    // sort the rest by octant
+    const vector<ofVec3f>& p = *source;
+    float half = size / 2;
+    ofVec3f middle = corner + ofVec3f(half, half, half);
+    size_t starts[9] = { 0 };
+    for (size_t i = 0; i < passed; i++) {
+        const ofVec3f& q = p[scratch[i]];
+        starts[1 + (q.x >= middle.x) + 2 * (q.y >= middle.y) + 4 * (q.z >= middle.z)]++;
+    }
+    for (int c = 0; c < 8; c++) starts[c + 1] += starts[c];
+    size_t childBegin = begin + kept;
+    size_t fill[8];
+    for (int c = 0; c < 8; c++) fill[c] = childBegin + starts[c];
+    for (size_t i = 0; i < passed; i++) {
+        const ofVec3f& q = p[scratch[i]];
+        order[fill[(q.x >= middle.x) + 2 * (q.y >= middle.y) + 4 * (q.z >= middle.z)]++] = scratch[i];
+    }
+
+    // (nodes may move as children are added, so self isn't used after this)
+    for (int c = 0; c < 8; c++) {
+        if (starts[c + 1] == starts[c]) continue;
+        ofVec3f childCorner = corner + ofVec3f((c & 1) ? half : 0, (c & 2) ? half : 0, (c & 4) ? half : 0);
+        int child = buildNode(childBegin + starts[c], childBegin + starts[c + 1], childCorner, half, depth + 1);
+        nodes[index].children[c] = child;
+    }
+    return index;
+}
+
+// ---------------------------------------------------------------------
+
+void urgOctree::clear() {
+
+    nodes.clear();
+    points.clear();
+    colors.clear();
+    drawRanges.clear();
+    vboDirty = true;
+}
+
+// ---------------------------------------------------------------------
+
+size_t urgOctree::size() {
+    return points.size();
+}
+
+// ---------------------------------------------------------------------
+
+int urgOctree::getNumNodes() {
+    return nodes.size();
+}
+
+// ---------------------------------------------------------------------
+
+const vector<ofVec3f>& urgOctree::getPoints() {
+    return points;
+}
+
+// ---------------------------------------------------------------------
+
+size_t urgOctree::select(const ofMatrix4x4& modelViewProjection, float viewWidth, float viewHeight, size_t pointBudget, float detailPixels, vector<urgOctreeRange>& ranges) {
+
+    ranges.clear();
+    if (nodes.empty()) return 0;
+
+    // (row vectors, as openFrameworks multiplies them)
+    const float* m = modelViewProjection.getPtr();
+
+    // nodes waiting to be drawn, by their size on screen
+    typedef pair<float, int> candidate;
+    priority_queue<candidate> queue;
+    queue.push(candidate(numeric_limits<float>::max(), 0));
+
+    size_t nSelected = 0;
+    float spread = sqrt((float)capacity);
+
+    while (!queue.empty()) {
+
+        int index = queue.top().second;
+        queue.pop();
+        const node& nd = nodes[index];
+
+        // the node's cube in clip space
+        int outside[6] = { 0 };
+        bool behind = false;
+        float minX = numeric_limits<float>::max(), maxX = -minX;
+        float minY = minX, maxY = -minX;
+        for (int c = 0; c < 8; c++) {
+            float x = nd.corner.x + ((c & 1) ? nd.size : 0);
+            float y = nd.corner.y + ((c & 2) ? nd.size : 0);
+            float z = nd.corner.z + ((c & 4) ? nd.size : 0);
+            float cx = x * m[0] + y * m[4] + z * m[8] + m[12];
+            float cy = x * m[1] + y * m[5] + z * m[9] + m[13];
+            float cz = x * m[2] + y * m[6] + z * m[10] + m[14];
+            float cw = x * m[3] + y * m[7] + z * m[11] + m[15];
+            outside[0] += cx < -cw;    outside[1] += cx > cw;
+            outside[2] += cy < -cw;    outside[3] += cy > cw;
+            outside[4] += cz < -cw;    outside[5] += cz > cw;
+            if (cw <= 1e-6) {
+                behind = true;
+                continue;
+            }
+            minX = min(minX, cx / cw);  maxX = max(maxX, cx / cw);
+            minY = min(minY, cy / cw);  maxY = max(maxY, cy / cw);
+        }
+
+        // out of view when every corner is past the same plane
+        bool culled = false;
+        for (int plane = 0; plane < 6; plane++) culled = culled || (outside[plane] == 8);
+        if (culled) continue;
+
+        // the largest side of the cube on screen (pixels); a cube reaching
+        // behind the camera could be any size
+        float pixels = behind ? numeric_limits<float>::max() : max((maxX - minX) * viewWidth, (maxY - minY) * viewHeight) / 2;
+
+        // draw it if it fits the budget (smaller nodes might still fit)
+        if (nd.count > 0 && nSelected + nd.count <= pointBudget) {
+            nSelected += nd.count;
+
+            // join ranges that follow each other in the point order
+            if (!ranges.empty() && ranges.back().first + ranges.back().count == nd.first) ranges.back().count += nd.count;
+            else {
+                urgOctreeRange range = { nd.first, nd.count };
+                ranges.push_back(range);
+            }
+        }
+        else if (nd.count > 0) continue;
+
+        // refine while the node's points are further apart on screen than the detail asked for
+        if (pixels / spread > detailPixels) {
+            for (int c = 0; c < 8; c++) {
+                int child = nd.children[c];
+                if (child >= 0) queue.push(candidate(pixels / 2, child));
+            }
+        }
+    }
+    return nSelected;
+}
+
+// ---------------------------------------------------------------------
+
+size_t urgOctree::draw(size_t pointBudget, float detailPixels) {
+
+    if (points.empty()) return 0;
+
+    if (vboDirty) {
+        vbo.setVertexData(points.data(), points.size(), GL_STATIC_DRAW);
+        if (!colors.empty()) vbo.setColorData(colors.data(), colors.size(), GL_STATIC_DRAW);
+        vboDirty = false;
+    }
+
+    ofMatrix4x4 modelViewProjection = ofGetCurrentMatrix(OF_MATRIX_MODELVIEW) * ofGetCurrentMatrix(OF_MATRIX_PROJECTION);
+    size_t nDrawn = select(modelViewProjection, ofGetViewportWidth(), ofGetViewportHeight(), pointBudget, detailPixels, drawRanges);
+
+    for (size_t i = 0; i < drawRanges.size(); i++) vbo.draw(GL_POINTS, drawRanges[i].first, drawRanges[i].count);
+    return nDrawn;
+}
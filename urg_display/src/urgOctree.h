@@ -0,0 +1,85 @@
+//
+//  urgOctree.h
+//  urg_display
+//
+//  Level of detail for drawing meshes too big to draw whole every frame.
+//  Each node of the octree holds up to nodeCapacity points spread through
+//  its cube and hands the rest down to its children, so the nodes near the
+//  root are a coarse version of the cloud and deeper nodes fill in detail.
+//  The points are reordered so that every node's points are contiguous and
+//  sit in one vbo; a frame draws the nodes in view, largest on screen
+//  first, until they're fine enough for the screen or the point budget is
+//  spent.
+//
+
+#ifndef __urg_display__urgOctree__
+#define __urg_display__urgOctree__
+
+#include "ofMain.h"
+
+// points [first, first + count) of the octree's point order
+struct urgOctreeRange {
+    size_t first;
+    size_t count;
+};
+
+class urgOctree {
+
+public:
+
+    // build from a mesh's points (and colors, if it has one per point)
+    void build(const ofMesh& mesh, int nodeCapacity = 8192, int maxDepth = 16);
+
+    void clear();
+
+    // number of points and nodes held
+    size_t size();
+    int getNumNodes();
+
+    // the ranges of points to draw for a view, given the transform from the
+    // mesh's coordinates to clip space (modelview * projection) and the size
+    // of the viewport in pixels
+    // nodes are refined until the gap between their points on screen is at
+    // most detailPixels; never selects more than pointBudget points
+    // returns the number of points selected
+    size_t select(const ofMatrix4x4& modelViewProjection, float viewWidth, float viewHeight, size_t pointBudget, float detailPixels, vector<urgOctreeRange>& ranges);
+
+    // draw the points of the nodes selected for the current transform and viewport
+    // returns the number of points drawn
+    size_t draw(size_t pointBudget, float detailPixels = 1.5);
+
+    // the points in octree order (draw ranges index into these)
+    const vector<ofVec3f>& getPoints();
+
+private:
+
+    struct node {
+        ofVec3f corner;     // minimum corner of the node's cube
+        float size;         // length of a side
+        size_t first;       // the node's own points
+        size_t count;
+        int children[8];    // -1 where a child is empty
+    };
+
+    // build the subtree for the points indexed by order[begin, end); returns its node
+    int buildNode(size_t begin, size_t end, ofVec3f corner, float size, int depth);
+
+    vector<node> nodes;
+    size_t capacity = 8192;
+    int depthLimit = 16;
+
+    // point indices during a build, and room to partition them
+    vector<uint32_t> order;
+    vector<uint32_t> scratch;
+    const vector<ofVec3f>* source = NULL;
+
+    vector<ofVec3f> points;
+    vector<ofFloatColor> colors;
+
+    ofVbo vbo;
+    bool vboDirty = true;
+    vector<urgOctreeRange> drawRanges;
+
+};
+
+#endif /* defined(__urg_display__urgOctree__) */
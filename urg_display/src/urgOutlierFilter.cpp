@@ -0,0 +1,101 @@
+//
+//  urgOutlierFilter.cpp
+//  urg_display
+//
+//  Statistical outlier removal for points that lie on the sensor's scan x
+//  beam grid. A point's neighbours are the points of the nearby beams of
+//  the nearby scans, found by looking around its grid cell (so there's no
+//  search structure to build). Each point gets the mean distance to its
+//  neighbours, relative to its distance from the sensor (beams spread apart
+//  with range, so a far wall isn't judged by the spacing of a near one);
+//  points whose mean is more than a number of standard deviations above
+//  the mean of all of them, or with no neighbours at all, are outliers.
+//  This catches the "mixed pixels" strung out between an edge and what's
+//  behind it, and spray. Rows of the grid are split across threads.
+//
+
+#include "urgOutlierFilter.h"
+#include "urgParallel.h"
+
+// mean distance of points with no neighbours
+#define URG_OUTLIER_ISOLATED -1.f
+
+size_t urgFindOutliers(const ofVec3f* points, size_t nPoints, const int32_t* cells, int nRows, int nColumns, int radius, float stdDevs, vector<uint8_t>& outliers) {
+
+    outliers.assign(nPoints, 0);
+    if (nPoints == 0 || nRows <= 0 || nColumns <= 0) return 0;
+    radius = max(radius, 1);
+
+    // each point's mean relative distance to its neighbours, and the sums of
+    // them per row (added up in row order after, so the result doesn't depend
+    // on how many threads there are)
+    vector<float> meanDistances(nPoints, URG_OUTLIER_ISOLATED);
+    vector<double> rowSums(nRows, 0);
+    vector<double> rowSquares(nRows, 0);
+    vector<size_t> rowCounts(nRows, 0);
+
+    urgParallelFor(nRows, [&](int, size_t begin, size_t end) {
+
+        for (size_t r = begin; r < end; r++) {
+
+            int r0 = max((int)r - radius, 0);
+            int r1 = min((int)r + radius, nRows - 1);
+            const int32_t* row = cells + r * nColumns;
+
+            for (int c = 0; c < nColumns; c++) {
+
+                int32_t p = row[c];
+                if (p < 0) continue;
+                const ofVec3f& point = points[p];
+
+                int c0 = max(c - radius, 0);
+                int c1 = min(c + radius, nColumns - 1);
+                float sum = 0;
+                int count = 0;
+                for (int nr = r0; nr <= r1; nr++) {
+                    const int32_t* neighbours = cells + (size_t)nr * nColumns;
+                    for (int nc = c0; nc <= c1; nc++) {
+                        int32_t n = neighbours[nc];
+                        if (n < 0 || n == p) continue;
+                        sum += point.distance(points[n]);
+                        count++;
+                    }
+                }
+                if (count == 0) continue;
+
+                float mean = sum / count / max(point.length(), 1.f);
+                meanDistances[p] = mean;
+                rowSums[r] += mean;
+                rowSquares[r] += (double)mean * mean;
+                rowCounts[r]++;
+            }
+        }
+    }, 16);
+
+    double sum = 0, squares = 0;
+    size_t count = 0;
+    for (int r = 0; r < nRows; r++) {
+        sum += rowSums[r];
+        squares += rowSquares[r];
+        count += rowCounts[r];
+    }
+    double mean = count > 0 ? sum / count : 0;
+    double deviation = count > 0 ? sqrt(max(squares / count - mean * mean, 0.)) : 0;
+    float threshold = mean + stdDevs * deviation;
+
+    // flag by point, in parallel again; each thread counts its own
+    int nChunks = urgNumChunks(nPoints, 4096);
+    vector<size_t> chunkOutliers(nChunks, 0);
+    urgParallelFor(nPoints, [&](int chunk, size_t begin, size_t end) {
+        for (size_t p = begin; p < end; p++) {
+            if (meanDistances[p] == URG_OUTLIER_ISOLATED || meanDistances[p] > threshold) {
+                outliers[p] = 1;
+                chunkOutliers[chunk]++;
+            }
+        }
+    }, 4096);
+
+    size_t nOutliers = 0;
+    for (int c = 0; c < nChunks; c++) nOutliers += chunkOutliers[c];
+    return nOutliers;
+}
@@ -0,0 +1,29 @@
+//
+//  urgOutlierFilter.h
+//  urg_display
+//
+//  Statistical outlier removal for points that lie on the sensor's scan x
+//  beam grid. A point's neighbours are the points of the nearby beams of
+//  the nearby scans, found by looking around its grid cell (so there's no
+//  search structure to build). Each point gets the mean distance to its
+//  neighbours, relative to its distance from the sensor (beams spread apart
+//  with range, so a far wall isn't judged by the spacing of a near one);
+//  points whose mean is more than a number of standard deviations above
+//  the mean of all of them, or with no neighbours at all, are outliers.
+//  This catches the "mixed pixels" strung out between an edge and what's
+//  behind it, and spray. Rows of the grid are split across threads.
+//
+
+#ifndef __urg_display__urgOutlierFilter__
+#define __urg_display__urgOutlierFilter__
+
+#include "ofMain.h"
+
+// flag the outliers among points laid out on a nRows x nColumns grid, where
+// cells[row * nColumns + column] is the index in points of the point at that
+// scan (row) and beam (column), or -1 if there's none
+// neighbours are the points within radius cells in both directions; outliers
+// gets one flag per point, and the number of outliers is returned
+size_t urgFindOutliers(const ofVec3f* points, size_t nPoints, const int32_t* cells, int nRows, int nColumns, int radius, float stdDevs, vector<uint8_t>& outliers);
+
+#endif /* defined(__urg_display__urgOutlierFilter__) */
@@ -0,0 +1,501 @@
+//
+//  urgRecording.cpp
+//  urg_capture_display
+//
+//  Reads scans from a recording made by urg_record, in the CSV layout or
+//  any of the binary layouts described in urgFormat.h
+//  The file is memory mapped and scans are read straight from its pages,
+//  so memory use stays constant however long the recording is, and any
+//  scan can be reached through the recording's urgScanIndex. Compressed
+//  recordings are read the same way a chunk at a time: reading a scan
+//  decodes its chunk into a small cache of recently decoded chunks.
+//
+
+#include "urgRecording.h"
+#include "urgCodec.h"
+#include "urgParallel.h"
+#include <atomic>
+
+// chunks each recording keeps decoded at least (threads reading in parallel
+// each get room for two, so they don't evict each other's)
+#define URG_DECODED_CHUNKS 4
+
+urgRecording::urgRecording() {
+
+    memset(&header, 0, sizeof(header));
+}
+
+// ---------------------------------------------------------------------
+
+bool urgRecording::load(string fileName) {
+
+    // chunks decoded from the last recording (or its segments)
+    {
+        std::lock_guard<std::mutex> lock(chunkMutex);
+        decodedChunks.clear();
+    }
+
+    // any segment of a segmented recording stands for its whole session
+    segments.clear();
+    segmentFirstScans.clear();
+    vector<string> segmentNames;
+    if (urgFindSegments(fileName, segmentNames)) return loadSegments(segmentNames);
+    return loadFile(fileName);
+}
+
+// ---------------------------------------------------------------------
+
+bool urgRecording::loadSegments(const vector<string>& segmentNames) {
+
+    file.close();
+    index.clear();
+    chunkOffsets.clear();
+    chunkFirstScans.clear();
+
+    segmentFirstScans.push_back(0);
+    for (size_t i = 0; i < segmentNames.size(); i++) {
+
+        // (which share the session's decoded chunks, so they're bounded however many segments there are)
+        shared_ptr<urgRecording> segment(new urgRecording);
+        segment->chunkCache = this;
+        if (!segment->loadFile(segmentNames[i])) break;
+
+        // a segment that doesn't continue the first one ends the session
+        if (!segments.empty()) {
+            const urgRecording& first = *segments[0];
+            bool continues = segment->binary == first.binary;
+            if (continues && first.binary) {
+                continues = segment->header.sessionId == first.header.sessionId && segment->header.layout == first.header.layout && segment->header.beamCount == first.header.beamCount;
+            }
+            if (!continues) {
+                ofLogWarning("urgRecording") << segmentNames[i] << " is not part of the same session as " << segmentNames[0] << "; stopping before it";
+                break;
+            }
+        }
+
+        segments.push_back(segment);
+        segmentFirstScans.push_back(segmentFirstScans.back() + segment->getNumScans());
+    }
+    if (segments.empty()) {
+        segmentFirstScans.clear();
+        return false;
+    }
+
+    // the session reads like its first segment
+    const urgRecording& first = *segments[0];
+    binary = first.binary;
+    header = first.header;
+    cosines = first.cosines;
+    sines = first.sines;
+    csvBeams = first.csvBeams;
+
+    rewind();
+    return true;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgRecording::loadFile(string fileName) {
+
+    if (!file.open(fileName)) return false;
+
+    // binary recordings start with a header; anything else is treated as CSV
+    binary = urgReadHeader(file.getData(), file.size(), header);
+    if (binary && header.layout > URG_LAYOUT_POLAR) {
+        ofLogError("urgRecording") << fileName << " has an unsupported record layout (" << header.layout << ")";
+        file.close();
+        binary = false;
+        return false;
+    }
+    if (binary && file.size() < header.headerSize) {
+        ofLogError("urgRecording") << fileName << " is shorter than its header (" << file.size() << " of " << header.headerSize << " bytes)";
+        file.close();
+        binary = false;
+        return false;
+    }
+
+    // the beam angles of recordings that hold ranges follow the header
+    chunkOffsets.clear();
+    chunkFirstScans.clear();
+    cosines.clear();
+    sines.clear();
+    if (binary && urgHasAngleTable(header.layout)) {
+        const float* angles = (const float*)(file.getData() + sizeof(urgRecordingHeader));
+        cosines.resize(header.beamCount);
+        sines.resize(header.beamCount);
+        for (uint32_t i = 0; i < header.beamCount; i++) {
+            cosines[i] = cos(angles[i]);
+            sines[i] = sin(angles[i]);
+        }
+    }
+
+    if (binary && header.layout == URG_LAYOUT_DELTA_RANGES) {
+        indexChunks();
+        rewind();
+        return true;
+    }
+
+    // csv indexes take a pass over the file to build, so they're kept in a sidecar file
+    string indexFileName = ofToDataPath(fileName, true) + "." URG_INDEX_EXTENSION;
+    if (binary || !index.load(indexFileName, file.getData(), file.size())) {
+        index.build(file.getData(), file.size(), binary ? &header : NULL);
+        if (!binary && !index.save(indexFileName, file.getData(), file.size())) {
+            ofLogWarning("urgRecording") << "could not save the scan index to " << indexFileName;
+        }
+        file.releaseBefore(file.size());
+    }
+
+    // the first readable scan of a csv recording sets its beam count
+    csvBeams = 0;
+    if (!binary) {
+        urgScan scan;
+        for (unsigned long i = 0; i < index.size(); i++) {
+            if (readScan(i, scan) != URG_PARSE_MALFORMED) {
+                csvBeams = scan.points.size();
+                break;
+            }
+        }
+    }
+
+    rewind();
+    return true;
+}
+
+// ---------------------------------------------------------------------
+
+int urgRecording::getNumSegments() {
+    return max((int)segments.size(), 1);
+}
+
+// ---------------------------------------------------------------------
+
+int urgRecording::segmentOf(unsigned long i) {
+
+    // the last segment whose first scan is at or before i
+    return upper_bound(segmentFirstScans.begin(), segmentFirstScans.end() - 1, i) - segmentFirstScans.begin() - 1;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgRecording::isBinary() {
+    return binary;
+}
+
+// ---------------------------------------------------------------------
+
+int urgRecording::getNumBeams() {
+    return binary ? header.beamCount : csvBeams;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgRecording::hasRanges() {
+    return binary && urgHasAngleTable(header.layout);
+}
+
+// ---------------------------------------------------------------------
+
+const float* urgRecording::getBeamCosines() {
+    return cosines.data();
+}
+
+const float* urgRecording::getBeamSines() {
+    return sines.data();
+}
+
+// ---------------------------------------------------------------------
+
+const urgRecordingHeader& urgRecording::getHeader() {
+    return header;
+}
+
+// ---------------------------------------------------------------------
+
+void urgRecording::rewind() {
+
+    nMalformed = 0;
+    nShort = 0;
+    for (size_t s = 0; s < segments.size(); s++) segments[s]->rewind();
+    seekScan(0);
+}
+
+// ---------------------------------------------------------------------
+
+unsigned long urgRecording::getNumScans() {
+    if (!segments.empty()) return segmentFirstScans.back();
+    return index.size();
+}
+
+// ---------------------------------------------------------------------
+
+unsigned long urgRecording::getScanIndex() {
+    return scanIndex;
+}
+
+// ---------------------------------------------------------------------
+
+void urgRecording::seekScan(unsigned long scan) {
+
+    scanIndex = min(scan, getNumScans());
+}
+
+// ---------------------------------------------------------------------
+
+double urgRecording::getScanTime(unsigned long scan) {
+    if (!segments.empty()) {
+        int s = segmentOf(scan);
+        return segments[s]->getScanTime(scan - segmentFirstScans[s]);
+    }
+    return index.getTime(scan);
+}
+
+// ---------------------------------------------------------------------
+
+unsigned long urgRecording::findScan(double time) {
+
+    // a session's times keep counting from one segment to the next
+    for (size_t s = 0; s < segments.size(); s++) {
+        unsigned long scan = segments[s]->findScan(time);
+        if (scan < segments[s]->getNumScans()) return segmentFirstScans[s] + scan;
+    }
+    if (!segments.empty()) return getNumScans();
+    return index.findTime(time);
+}
+
+// ---------------------------------------------------------------------
+
+void urgRecording::indexChunks() {
+
+    uint32_t nBeams = header.beamCount;
+
+    // find the chunks (a partly written chunk at the end is left out)
+    unsigned long nScans = 0;
+    uint64_t offset = header.headerSize;
+    urgChunkHeader chunkHeader;
+    while (offset <= file.size() && urgReadChunkHeader(file.getData() + offset, file.size() - offset, chunkHeader)) {
+        chunkOffsets.push_back(offset);
+        chunkFirstScans.push_back(nScans);
+        nScans += chunkHeader.nScans;
+        offset += sizeof(chunkHeader) + chunkHeader.payloadSize;
+    }
+    if (offset < file.size()) {
+        ofLogWarning("urgRecording") << "ignoring " << file.size() - offset << " bytes after the last complete chunk";
+    }
+    chunkFirstScans.push_back(nScans);
+
+    // read the scans' times (without their ranges) in parallel
+    bool runs = header.version >= URG_CHUNK_RUNS_VERSION;
+    vector<uint32_t> scanTimes(nScans);
+    std::atomic<int> nCorrupt(0);
+    urgParallelFor(chunkOffsets.size(), [&](int, size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            unsigned long first = chunkFirstScans[c];
+            if (!urgDecodeChunk(file.getData() + chunkOffsets[c], file.size() - chunkOffsets[c], nBeams, &scanTimes[first], NULL, runs)) {
+                nCorrupt++;
+            }
+        }
+    });
+    file.releaseBefore(file.size());
+    if (nCorrupt > 0) {
+        ofLogWarning("urgRecording") << nCorrupt << " chunks could not be decoded";
+    }
+
+    // a scan's offset is that of its chunk
+    vector<uint64_t> offsets(nScans);
+    vector<double> times(nScans);
+    for (size_t c = 0; c < chunkOffsets.size(); c++) {
+        for (unsigned long i = chunkFirstScans[c]; i < chunkFirstScans[c + 1]; i++) {
+            offsets[i] = chunkOffsets[c];
+            times[i] = scanTimes[i];
+        }
+    }
+    index.assign(offsets, times);
+}
+
+// ---------------------------------------------------------------------
+
+shared_ptr<const urgRecording::decodedChunk> urgRecording::getChunk(size_t chunk) {
+
+    urgRecording& cache = *chunkCache;
+    {
+        std::lock_guard<std::mutex> lock(cache.chunkMutex);
+        list<shared_ptr<const decodedChunk> >& chunks = cache.decodedChunks;
+        for (list<shared_ptr<const decodedChunk> >::iterator it = chunks.begin(); it != chunks.end(); ++it) {
+            if ((*it)->recording != this || (*it)->chunk != chunk) continue;
+            chunks.splice(chunks.begin(), chunks, it);
+            return chunks.front();
+        }
+    }
+
+    // decode it outside the lock, so threads decode their chunks in parallel
+    uint32_t nBeams = header.beamCount;
+    unsigned long nScans = chunkFirstScans[chunk + 1] - chunkFirstScans[chunk];
+    shared_ptr<decodedChunk> decoded(new decodedChunk);
+    decoded->recording = this;
+    decoded->chunk = chunk;
+    decoded->ranges.resize((size_t)nScans * nBeams);
+    vector<uint32_t> times(nScans);
+    if (!urgDecodeChunk(file.getData() + chunkOffsets[chunk], file.size() - chunkOffsets[chunk], nBeams, times.data(), decoded->ranges.data(), header.version >= URG_CHUNK_RUNS_VERSION)) {
+        decoded->ranges.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(cache.chunkMutex);
+    cache.decodedChunks.push_front(decoded);
+    size_t capacity = max(URG_DECODED_CHUNKS, 2 * urgNumThreads());
+    while (cache.decodedChunks.size() > capacity) cache.decodedChunks.pop_back();
+    return decoded;
+}
+
+// ---------------------------------------------------------------------
+
+urgParseResult urgRecording::readScan(unsigned long i, urgScan& scan, bool cartesian) {
+
+    if (!segments.empty()) {
+        int s = segmentOf(i);
+        return segments[s]->readScan(i - segmentFirstScans[s], scan, cartesian);
+    }
+
+    scan.ranges.clear();
+
+    if (hasRanges()) {
+        uint32_t nBeams = header.beamCount;
+        if (header.layout == URG_LAYOUT_POLAR) {
+            const char* record = file.getData() + index.getOffset(i);
+            uint32_t time;
+            memcpy(&time, record, sizeof(time));
+            scan.time = time;
+            scan.ranges.resize(nBeams);
+            memcpy(scan.ranges.data(), record + sizeof(time), sizeof(int32_t) * nBeams);
+        }
+        else {
+            scan.time = index.getTime(i);
+            size_t c = upper_bound(chunkFirstScans.begin(), chunkFirstScans.end() - 1, i) - chunkFirstScans.begin() - 1;
+            shared_ptr<const decodedChunk> chunk = getChunk(c);
+            if (chunk->ranges.empty()) {
+                scan.points.clear();
+                return URG_PARSE_MALFORMED;
+            }
+            const int32_t* first = &chunk->ranges[(size_t)(i - chunkFirstScans[c]) * nBeams];
+            scan.ranges.assign(first, first + nBeams);
+        }
+
+        if (cartesian) {
+            scan.points.resize(nBeams);
+            urgRangesToCartesian(scan.ranges.data(), cosines.data(), sines.data(), nBeams, (float*)scan.points.data());
+        }
+        else scan.points.clear();
+        return URG_PARSE_OK;
+    }
+
+    if (binary) {
+        const char* record = file.getData() + index.getOffset(i);
+        uint32_t time;
+        memcpy(&time, record, sizeof(time));
+        scan.time = time;
+        scan.points.resize(header.beamCount);
+        memcpy(&scan.points[0], record + sizeof(time), 2 * sizeof(float) * header.beamCount);
+        return URG_PARSE_OK;
+    }
+
+    // csv: time, then an x and a y for each beam
+    const char* data = file.getData();
+    const char* begin = data + index.getOffset(i);
+    const char* end = (const char*)memchr(begin, '\n', file.size() - index.getOffset(i));
+    if (end == NULL) end = data + file.size();
+    if (end > begin && *(end - 1) == '\r') end--;
+
+    // parse straight into the scan's points (which keep their memory between scans)
+    if (scan.points.size() < (size_t)csvBeams) scan.points.resize(csvBeams);
+    int nValues;
+    urgParseResult result = urgParseScanLine(begin, end, scan.time, (float*)scan.points.data(), 2 * scan.points.size(), nValues);
+
+    // more beams than there was room for: make room and parse again
+    if (result == URG_PARSE_LONG) {
+        scan.points.resize(nValues / 2 + nValues % 2);
+        result = urgParseScanLine(begin, end, scan.time, (float*)scan.points.data(), 2 * scan.points.size(), nValues);
+    }
+
+    if (result == URG_PARSE_MALFORMED) {
+        scan.points.clear();
+        return result;
+    }
+
+    int nBeams = nValues / 2;
+    scan.points.resize(nBeams);
+    if (nBeams < csvBeams) result = URG_PARSE_SHORT;
+    return result;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgRecording::nextScan(urgScan& scan, bool cartesian) {
+
+    // read on through the segments (which report their own problems)
+    while (!segments.empty() && scanIndex < getNumScans()) {
+        int s = segmentOf(scanIndex);
+        urgRecording& segment = *segments[s];
+        if (segment.getScanIndex() != scanIndex - segmentFirstScans[s]) segment.seekScan(scanIndex - segmentFirstScans[s]);
+        bool read = segment.nextScan(scan, cartesian);
+        scanIndex = segmentFirstScans[s] + segment.getScanIndex();
+        if (read) return true;
+    }
+
+    while (scanIndex < index.size()) {
+
+        urgParseResult result = readScan(scanIndex++, scan, cartesian);
+
+        // hand back pages we've read past
+        file.releaseBefore((scanIndex < index.size()) ? index.getOffset(scanIndex) : file.size());
+
+        if (result == URG_PARSE_MALFORMED) {
+            nMalformed++;
+            reportLine("is not a list of numbers; skipping it");
+            continue;
+        }
+        if (result == URG_PARSE_SHORT) {
+            nShort++;
+            reportLine("has " + ofToString(scan.points.size()) + " complete beams instead of " + ofToString(csvBeams));
+        }
+        return true;
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------
+
+void urgRecording::reportLine(string problem) {
+
+    // don't flood the log for a badly damaged file
+    unsigned long nReported = nMalformed + nShort;
+    if (nReported <= 10) {
+        ofLogWarning("urgRecording") << "scan " << scanIndex - 1 << " " << problem;
+    }
+    if (nReported == 10) {
+        ofLogWarning("urgRecording") << "further problems with this recording are counted but not reported";
+    }
+}
+
+// ---------------------------------------------------------------------
+
+unsigned long urgRecording::getMalformedScans() {
+    unsigned long n = nMalformed;
+    for (size_t s = 0; s < segments.size(); s++) n += segments[s]->getMalformedScans();
+    return n;
+}
+
+// ---------------------------------------------------------------------
+
+unsigned long urgRecording::getShortScans() {
+    unsigned long n = nShort;
+    for (size_t s = 0; s < segments.size(); s++) n += segments[s]->getShortScans();
+    return n;
+}
+
+// ---------------------------------------------------------------------
+
+unsigned long urgRecording::skipScans(unsigned long n) {
+
+    unsigned long first = scanIndex;
+    seekScan(scanIndex + min(n, getNumScans() - scanIndex));
+    return scanIndex - first;
+}
@@ -0,0 +1,155 @@
+//
+//  urgRecording.h
+//  urg_capture_display
+//
+//  Reads scans from a recording made by urg_record, in the CSV layout or
+//  any of the binary layouts described in urgFormat.h
+//  The file is memory mapped and scans are read straight from its pages,
+//  so memory use stays constant however long the recording is, and any
+//  scan can be reached through the recording's urgScanIndex. Compressed
+//  recordings are read the same way a chunk at a time: reading a scan
+//  decodes its chunk into a small cache of recently decoded chunks.
+//  Loading any segment of a segmented recording loads the whole session,
+//  which reads as one recording (each segment is mapped and indexed on its own).
+//
+
+#ifndef __urg_capture_display__urgRecording__
+#define __urg_capture_display__urgRecording__
+
+#include "ofMain.h"
+#include "urgFormat.h"
+#include "urgMappedFile.h"
+#include "urgScanParser.h"
+#include "urgScanIndex.h"
+#include <mutex>
+
+// a single scan read from a recording
+struct urgScan {
+    double time;                // milliseconds since the start of the recording
+    vector<ofVec2f> points;     // millimeters, one per beam, in the XY plane
+    vector<int32_t> ranges;     // millimeters, one per beam, for recordings that hold ranges (else empty)
+};
+
+class urgRecording {
+
+public:
+
+    urgRecording();
+
+    // map a recording (format is detected from its contents) and load or build its index;
+    // a segment loads every segment of its session
+    bool load(string fileName);
+
+    // segments of the session loaded (1 for a recording that isn't segmented)
+    int getNumSegments();
+
+    bool isBinary();
+    const urgRecordingHeader& getHeader();
+
+    // whether scans hold the ranges the sensor sent (compressed and polar
+    // recordings), and the cos and sin of each beam's angle for converting them
+    bool hasRanges();
+    const float* getBeamCosines();
+    const float* getBeamSines();
+
+    // beams per scan (a csv recording's are those of its first readable line)
+    int getNumBeams();
+
+    // go back to the first scan
+    void rewind();
+
+    // number of scans in the recording
+    unsigned long getNumScans();
+
+    // index of the scan nextScan() reads next
+    unsigned long getScanIndex();
+
+    // go to a scan by its index
+    void seekScan(unsigned long scan);
+
+    // time (ms) of a scan, and the first scan taken at or after a time (getNumScans() if none)
+    double getScanTime(unsigned long scan);
+    unsigned long findScan(double time);
+
+    // read the next scan; returns false at the end of the recording
+    // malformed csv lines are reported and skipped; short lines are reported
+    // and read with the beams they have
+    // without cartesian, scans of recordings that hold ranges are left as ranges (points stay empty)
+    bool nextScan(urgScan& scan, bool cartesian = true);
+
+    // skip the next n scans without parsing them; returns the number skipped
+    unsigned long skipScans(unsigned long n);
+
+    // read scan i without moving the read position or reporting problems
+    // (safe to call from several threads at once)
+    urgParseResult readScan(unsigned long i, urgScan& scan, bool cartesian = true);
+
+    // lines reported since the last rewind
+    unsigned long getMalformedScans();
+    unsigned long getShortScans();
+
+private:
+
+    // map and index a single file
+    bool loadFile(string fileName);
+
+    // load the segments of a session, in order
+    bool loadSegments(const vector<string>& segmentNames);
+
+    // segment holding scan i (of a session)
+    int segmentOf(unsigned long i);
+
+    // a session's segments, and the index of each segment's first scan (then the number of scans)
+    vector<shared_ptr<urgRecording> > segments;
+    vector<unsigned long> segmentFirstScans;
+
+    // log a problem with the scan that was just read
+    void reportLine(string problem);
+
+    // find the chunks of a compressed recording and index their scans
+    void indexChunks();
+
+    urgMappedFile file;
+    bool binary = false;
+    urgRecordingHeader header;
+
+    urgScanIndex index;
+
+    // index of the scan nextScan() reads next
+    unsigned long scanIndex = 0;
+
+    // compressed recordings: where each chunk starts, and the index of its
+    // first scan (then the number of scans)
+    vector<uint64_t> chunkOffsets;
+    vector<unsigned long> chunkFirstScans;
+
+    // a chunk's ranges (mm, beamCount per scan), empty if it's corrupt
+    struct decodedChunk {
+        const urgRecording* recording;
+        size_t chunk;
+        vector<int32_t> ranges;
+    };
+
+    // decode a chunk, or find it among the chunks decoded last (a reader
+    // holds on to its chunk while other threads replace the cache's)
+    shared_ptr<const decodedChunk> getChunk(size_t chunk);
+
+    // the chunks decoded last, most recent first, kept by the recording
+    // chunkCache points to (a segment's session, else this one)
+    urgRecording* chunkCache = this;
+    list<shared_ptr<const decodedChunk> > decodedChunks;
+    std::mutex chunkMutex;
+
+    // recordings that hold ranges: the direction of each beam
+    vector<float> cosines;
+    vector<float> sines;
+
+    // beams per scan in a csv recording, taken from its first line
+    int csvBeams = 0;
+
+    unsigned long nMalformed = 0;
+    unsigned long nShort = 0;
+
+};
+
+#endif /* defined(__urg_capture_display__urgRecording__) */
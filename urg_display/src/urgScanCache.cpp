@@ -0,0 +1,171 @@
+//
+//  urgScanCache.cpp
+//  urg_display
+//
+//  Every scan of a recording, parsed once and held as a structure of arrays:
+//  the scans' times, then one row per scan of either the ranges the sensor
+//  sent (recordings that hold ranges) or the x and y of each beam (in
+//  separate arrays). Fills with new parameters then only transform the rows
+//  instead of reading (and, for csv, parsing) the recording again. Rows are
+//  all as wide as the recording's beam count; short scans keep how many
+//  beams they have, and malformed ones are held empty and not valid.
+//
+
+#include "urgScanCache.h"
+#include "urgParallel.h"
+
+size_t urgScanCache::getBytes(urgRecording& recording) {
+
+    size_t rowBytes = (size_t)recording.getNumBeams() * (recording.hasRanges() ? sizeof(int32_t) : 2 * sizeof(float));
+    return recording.getNumScans() * (rowBytes + sizeof(double) + sizeof(uint8_t) + sizeof(int32_t));
+}
+
+// ---------------------------------------------------------------------
+
+bool urgScanCache::build(urgRecording& recording, size_t maxBytes) {
+
+    clear();
+    if (maxBytes > 0 && getBytes(recording) > maxBytes) return false;
+
+    unsigned long nScans = recording.getNumScans();
+    nBeams = recording.getNumBeams();
+    rangesCached = recording.hasRanges();
+    size_t nValues = (size_t)nScans * nBeams;
+
+    times.assign(nScans, 0);
+    valid.assign(nScans, 0);
+    scanBeams.assign(nScans, 0);
+    if (rangesCached) {
+        ranges.assign(nValues, 0);
+        cosines.assign(recording.getBeamCosines(), recording.getBeamCosines() + nBeams);
+        sines.assign(recording.getBeamSines(), recording.getBeamSines() + nBeams);
+    }
+    else {
+        xs.assign(nValues, 0);
+        ys.assign(nValues, 0);
+    }
+
+    // each thread parses its own scans straight into their rows
+    // (beams past the row of a csv line that's too long are dropped)
+    urgParallelFor(nScans, [&](int chunk, size_t begin, size_t end) {
+
+        urgScan scan;
+        for (size_t s = begin; s < end; s++) {
+
+            times[s] = recording.getScanTime(s);
+            if (recording.readScan(s, scan, false) == URG_PARSE_MALFORMED) continue;
+            times[s] = scan.time;
+            valid[s] = 1;
+
+            size_t row = s * nBeams;
+            if (rangesCached) {
+                int n = min((int)scan.ranges.size(), nBeams);
+                if (n > 0) memcpy(&ranges[row], scan.ranges.data(), n * sizeof(int32_t));
+                scanBeams[s] = n;
+                continue;
+            }
+            int n = min((int)scan.points.size(), nBeams);
+            for (int i = 0; i < n; i++) {
+                xs[row + i] = scan.points[i].x;
+                ys[row + i] = scan.points[i].y;
+            }
+            scanBeams[s] = n;
+        }
+    }, 64);
+
+    size_t nInvalid = count(valid.begin(), valid.end(), 0);
+    if (nInvalid > 0) ofLogWarning("urgScanCache") << nInvalid << " of " << nScans << " scans could not be read";
+
+    built = true;
+    return true;
+}
+
+// ---------------------------------------------------------------------
+
+void urgScanCache::clear() {
+
+    built = false;
+    nBeams = 0;
+    vector<double>().swap(times);
+    vector<uint8_t>().swap(valid);
+    vector<int32_t>().swap(scanBeams);
+    vector<int32_t>().swap(ranges);
+    vector<float>().swap(xs);
+    vector<float>().swap(ys);
+    cosines.clear();
+    sines.clear();
+}
+
+// ---------------------------------------------------------------------
+
+bool urgScanCache::isBuilt() {
+    return built;
+}
+
+unsigned long urgScanCache::getNumScans() {
+    return times.size();
+}
+
+int urgScanCache::getNumBeams() {
+    return nBeams;
+}
+
+bool urgScanCache::hasRanges() {
+    return rangesCached;
+}
+
+const float* urgScanCache::getBeamCosines() {
+    return cosines.data();
+}
+
+const float* urgScanCache::getBeamSines() {
+    return sines.data();
+}
+
+// ---------------------------------------------------------------------
+
+double urgScanCache::getTime(unsigned long scan) {
+    return times[scan];
+}
+
+bool urgScanCache::isValid(unsigned long scan) {
+    return valid[scan] != 0;
+}
+
+int urgScanCache::getScanBeams(unsigned long scan) {
+    return scanBeams[scan];
+}
+
+const int32_t* urgScanCache::getRanges(unsigned long scan) {
+    return ranges.data() + (size_t)scan * nBeams;
+}
+
+const float* urgScanCache::getX(unsigned long scan) {
+    return xs.data() + (size_t)scan * nBeams;
+}
+
+const float* urgScanCache::getY(unsigned long scan) {
+    return ys.data() + (size_t)scan * nBeams;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgScanCache::getScan(unsigned long scan, urgScan& out) {
+
+    out.time = times[scan];
+    out.points.clear();
+    out.ranges.clear();
+    if (!valid[scan]) return false;
+
+    int n = scanBeams[scan];
+    if (rangesCached) {
+        const int32_t* row = getRanges(scan);
+        out.ranges.assign(row, row + n);
+        return true;
+    }
+    const float* x = getX(scan);
+    const float* y = getY(scan);
+    out.points.resize(n);
+    for (int i = 0; i < n; i++) out.points[i].set(x[i], y[i]);
+    return true;
+}
@@ -0,0 +1,79 @@
+//
+//  urgScanCache.h
+//  urg_display
+//
+//  Every scan of a recording, parsed once and held as a structure of arrays:
+//  the scans' times, then one row per scan of either the ranges the sensor
+//  sent (recordings that hold ranges) or the x and y of each beam (in
+//  separate arrays). Fills with new parameters then only transform the rows
+//  instead of reading (and, for csv, parsing) the recording again. Rows are
+//  all as wide as the recording's beam count; short scans keep how many
+//  beams they have, and malformed ones are held empty and not valid.
+//
+
+#ifndef __urg_display__urgScanCache__
+#define __urg_display__urgScanCache__
+
+#include "ofMain.h"
+#include "urgRecording.h"
+
+class urgScanCache {
+
+public:
+
+    // parse every scan of a recording (in parallel); if that would take more
+    // than maxBytes (0 for no limit), the cache is left empty and false returned
+    bool build(urgRecording& recording, size_t maxBytes = 0);
+
+    // bytes the cache of a recording would take
+    static size_t getBytes(urgRecording& recording);
+
+    void clear();
+
+    // whether a recording has been cached
+    bool isBuilt();
+
+    unsigned long getNumScans();
+    int getNumBeams();
+
+    // whether rows hold ranges (else x and y), and the cos and sin of each
+    // beam's angle for converting them
+    bool hasRanges();
+    const float* getBeamCosines();
+    const float* getBeamSines();
+
+    // a scan's time (ms), whether it was read, and the beams it has
+    double getTime(unsigned long scan);
+    bool isValid(unsigned long scan);
+    int getScanBeams(unsigned long scan);
+
+    // a scan's row: ranges (mm), or x and y (mm)
+    const int32_t* getRanges(unsigned long scan);
+    const float* getX(unsigned long scan);
+    const float* getY(unsigned long scan);
+
+    // copy a scan out as urgRecording::readScan() reads it without cartesian;
+    // returns false for scans that weren't valid
+    bool getScan(unsigned long scan, urgScan& out);
+
+private:
+
+    bool built = false;
+    bool rangesCached = false;
+    int nBeams = 0;
+
+    vector<double> times;
+    vector<uint8_t> valid;
+    vector<int32_t> scanBeams;
+
+    // nBeams per scan
+    vector<int32_t> ranges;
+    vector<float> xs;
+    vector<float> ys;
+
+    vector<float> cosines;
+    vector<float> sines;
+
+};
+
+#endif /* defined(__urg_display__urgScanCache__) */
@@ -0,0 +1,173 @@
+//
+//  urgScanIndex.cpp
+//  urg_capture_display
+//
+//  Byte offset and time of every scan in a recording, so any scan can be
+//  reached without reading the scans before it. Built once per recording
+//  and saved next to it as a sidecar file (<recording>.idx).
+//
+
+#include "urgScanIndex.h"
+#include "urgScanParser.h"
+
+/* sidecar layout (little endian):
+        magic "URGI" | version (uint32) | recording size (uint64) | fingerprint (uint64) |
+        nScans (uint64) | offsets (uint64 x nScans) | times (double x nScans)
+ */
+
+void urgScanIndex::build(const char* data, size_t size, const urgRecordingHeader* header) {
+
+    clear();
+
+    if (header != NULL) {
+
+        // binary: records are fixed size, so only the times need reading
+        unsigned long nScans = (size - min((size_t)header->headerSize, size)) / header->recordSize;
+        offsets.resize(nScans);
+        times.resize(nScans);
+        for (unsigned long i = 0; i < nScans; i++) {
+            offsets[i] = header->headerSize + (uint64_t)i * header->recordSize;
+            uint32_t time;
+            memcpy(&time, data + offsets[i], sizeof(time));
+            times[i] = time;
+        }
+        return;
+    }
+
+    // csv: one scan per non-empty line, starting with its time
+    size_t offset = 0;
+    double lastTime = 0;
+    while (offset < size) {
+
+        const char* begin = data + offset;
+        const char* end = (const char*)memchr(begin, '\n', size - offset);
+        if (end == NULL) end = data + size;
+        size_t next = end - data + 1;
+
+        if (end > begin && !(end == begin + 1 && *begin == '\r')) {
+            // a line without a readable time keeps the previous time, so times stay sorted
+            const char* p = begin;
+            double time;
+            if (urgParseNumber(p, end, time)) lastTime = time;
+            offsets.push_back(offset);
+            times.push_back(lastTime);
+        }
+        offset = next;
+    }
+}
+
+// ---------------------------------------------------------------------
+
+void urgScanIndex::assign(vector<uint64_t>& scanOffsets, vector<double>& scanTimes) {
+
+    offsets.swap(scanOffsets);
+    times.swap(scanTimes);
+}
+
+// ---------------------------------------------------------------------
+
+uint64_t urgScanIndex::fingerprint(const char* data, size_t size) {
+
+    // FNV-1a over both ends (which overlap for small recordings)
+    size_t n = min(size, (size_t)URG_INDEX_FINGERPRINT_BYTES);
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < n; i++) hash = (hash ^ (uint8_t)data[i]) * 0x100000001b3ULL;
+    for (size_t i = size - n; i < size; i++) hash = (hash ^ (uint8_t)data[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgScanIndex::load(string fileName, const char* data, size_t size) {
+
+    clear();
+
+    ofFile file(fileName, ofFile::ReadOnly, true);
+    if (!file.is_open()) return false;
+
+    char magic[4];
+    uint32_t version;
+    uint64_t indexedSize, indexedFingerprint, nScans;
+    file.read(magic, 4);
+    file.read((char*)&version, sizeof(version));
+    file.read((char*)&indexedSize, sizeof(indexedSize));
+    file.read((char*)&indexedFingerprint, sizeof(indexedFingerprint));
+    file.read((char*)&nScans, sizeof(nScans));
+    if (!file || memcmp(magic, URG_INDEX_MAGIC, 4) != 0 || version != URG_INDEX_VERSION) return false;
+    if (indexedSize != size || indexedFingerprint != fingerprint(data, size)) return false;
+
+    // the count has to match the sidecar's length (and every scan takes a
+    // byte of the recording at least) before it sizes anything
+    uint64_t headerBytes = 4 + sizeof(version) + sizeof(indexedSize) + sizeof(indexedFingerprint) + sizeof(nScans);
+    if (nScans > size || file.getSize() != headerBytes + nScans * (sizeof(uint64_t) + sizeof(double))) return false;
+
+    offsets.resize(nScans);
+    times.resize(nScans);
+    file.read((char*)offsets.data(), nScans * sizeof(uint64_t));
+    file.read((char*)times.data(), nScans * sizeof(double));
+    bool valid = (bool)file;
+
+    // offsets lie inside the recording, in order
+    for (uint64_t i = 0; valid && i < nScans; i++) {
+        valid = offsets[i] < size && (i == 0 || offsets[i] > offsets[i - 1]);
+    }
+    if (!valid) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgScanIndex::save(string fileName, const char* data, size_t size) {
+
+    ofFile file(fileName, ofFile::WriteOnly, true);
+    if (!file.is_open()) return false;
+
+    uint32_t version = URG_INDEX_VERSION;
+    uint64_t recordingSize = size;
+    uint64_t recordingFingerprint = fingerprint(data, size);
+    uint64_t nScans = offsets.size();
+    file.write(URG_INDEX_MAGIC, 4);
+    file.write((const char*)&version, sizeof(version));
+    file.write((const char*)&recordingSize, sizeof(recordingSize));
+    file.write((const char*)&recordingFingerprint, sizeof(recordingFingerprint));
+    file.write((const char*)&nScans, sizeof(nScans));
+    file.write((const char*)offsets.data(), nScans * sizeof(uint64_t));
+    file.write((const char*)times.data(), nScans * sizeof(double));
+    return (bool)file;
+}
+
+// ---------------------------------------------------------------------
+
+void urgScanIndex::clear() {
+
+    offsets.clear();
+    times.clear();
+}
+
+// ---------------------------------------------------------------------
+
+unsigned long urgScanIndex::size() {
+    return offsets.size();
+}
+
+// ---------------------------------------------------------------------
+
+uint64_t urgScanIndex::getOffset(unsigned long scan) {
+    return offsets[scan];
+}
+
+// ---------------------------------------------------------------------
+
+double urgScanIndex::getTime(unsigned long scan) {
+    return times[scan];
+}
+
+// ---------------------------------------------------------------------
+
+unsigned long urgScanIndex::findTime(double time) {
+
+    return lower_bound(times.begin(), times.end(), time) - times.begin();
+}
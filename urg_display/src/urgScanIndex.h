@@ -0,0 +1,60 @@
+//
+//  urgScanIndex.h
+//  urg_capture_display
+//
+//  Byte offset and time of every scan in a recording, so any scan can be
+//  reached without reading the scans before it. Built once per recording
+//  and saved next to it as a sidecar file (<recording>.idx).
+//
+
+#ifndef __urg_capture_display__urgScanIndex__
+#define __urg_capture_display__urgScanIndex__
+
+#include "ofMain.h"
+#include "urgFormat.h"
+
+#define URG_INDEX_MAGIC "URGI"
+#define URG_INDEX_VERSION 2
+#define URG_INDEX_EXTENSION "idx"
+
+// bytes at each end of a recording that its index's fingerprint covers
+#define URG_INDEX_FINGERPRINT_BYTES (64 * 1024)
+
+class urgScanIndex {
+
+public:
+
+    // index a mapped recording; header is NULL for csv recordings
+    void build(const char* data, size_t size, const urgRecordingHeader* header);
+
+    // use offsets and times found some other way (the vectors are swapped in)
+    void assign(vector<uint64_t>& scanOffsets, vector<double>& scanTimes);
+
+    // read or write the sidecar file for the mapped recording; an index made
+    // for a recording of a different size (e.g. one still being recorded) or
+    // with different data at either end (e.g. one recorded over) fails to load
+    bool load(string fileName, const char* data, size_t size);
+    bool save(string fileName, const char* data, size_t size);
+
+    void clear();
+
+    unsigned long size();
+
+    // byte offset and time (ms) of a scan
+    uint64_t getOffset(unsigned long scan);
+    double getTime(unsigned long scan);
+
+    // first scan taken at or after time (ms); size() if there is none
+    unsigned long findTime(double time);
+
+private:
+
+    // hash of the first and last URG_INDEX_FINGERPRINT_BYTES of a recording
+    static uint64_t fingerprint(const char* data, size_t size);
+
+    vector<uint64_t> offsets;
+    vector<double> times;
+
+};
+
+#endif /* defined(__urg_capture_display__urgScanIndex__) */
@@ -0,0 +1,139 @@
+//
+//  urgScanParser.cpp
+//  urg_capture_display
+//
+//  Parses CSV scan lines (time, x0, y0, x1, y1, ...) straight into float
+//  arrays, without splitting the line into strings.
+//
+
+#include "urgScanParser.h"
+
+// exactly representable powers of ten
+static const double powersOf10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// ---------------------------------------------------------------------
+
+// numbers the fast path can't represent exactly (long mantissas, large exponents, nan, inf)
+// go through strtod on a copy of the token
+static bool parseNumberSlow(const char*& p, const char* end, double& value) {
+
+    char token[64];
+    size_t length = 0;
+    while (p + length < end && p[length] != ',' && length < sizeof(token) - 1) {
+        token[length] = p[length];
+        length++;
+    }
+    token[length] = '\0';
+
+    char* parsedEnd;
+    value = strtod(token, &parsedEnd);
+    if (parsedEnd == token) return false;
+
+    p += parsedEnd - token;
+    return true;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgParseNumber(const char*& p, const char* end, double& value) {
+
+    const char* s = p;
+    while (s < end && (*s == ' ' || *s == '\t')) s++;
+    const char* start = s;
+
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = (*s == '-');
+        s++;
+    }
+
+    // read up to 19 digits into an integer mantissa
+    uint64_t mantissa = 0;
+    int nDigits = 0;
+    int exponent = 0;
+
+    const char* digits = s;
+    while (s < end && (unsigned)(*s - '0') < 10) {
+        mantissa = mantissa * 10 + (*s - '0');
+        nDigits++;
+        s++;
+    }
+    bool anyDigits = (s > digits);
+
+    if (s < end && *s == '.') {
+        s++;
+        const char* fraction = s;
+        while (s < end && (unsigned)(*s - '0') < 10) {
+            mantissa = mantissa * 10 + (*s - '0');
+            nDigits++;
+            exponent--;
+            s++;
+        }
+        anyDigits = anyDigits || (s > fraction);
+    }
+
+    if (!anyDigits) return parseNumberSlow(p = start, end, value);
+
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char* e = s + 1;
+        bool negativeExponent = false;
+        if (e < end && (*e == '-' || *e == '+')) {
+            negativeExponent = (*e == '-');
+            e++;
+        }
+        if (e == end || (unsigned)(*e - '0') >= 10) return false;
+        int exponentValue = 0;
+        while (e < end && (unsigned)(*e - '0') < 10 && exponentValue < 10000) {
+            exponentValue = exponentValue * 10 + (*e - '0');
+            e++;
+        }
+        exponent += negativeExponent ? -exponentValue : exponentValue;
+        s = e;
+    }
+
+    if (nDigits > 19 || exponent < -22 || exponent > 22) return parseNumberSlow(p = start, end, value);
+
+    value = (double)mantissa;
+    value = (exponent < 0) ? value / powersOf10[-exponent] : value * powersOf10[exponent];
+    if (negative) value = -value;
+
+    p = s;
+    return true;
+}
+
+// ---------------------------------------------------------------------
+
+urgParseResult urgParseScanLine(const char* begin, const char* end, double& time, float* xy, int maxValues, int& nValues) {
+
+    nValues = 0;
+
+    const char* p = begin;
+    if (!urgParseNumber(p, end, time)) return URG_PARSE_MALFORMED;
+
+    while (p < end) {
+
+        // skip spaces after a value
+        if (*p == ' ' || *p == '\t') {
+            p++;
+            continue;
+        }
+        if (*p != ',') return URG_PARSE_MALFORMED;
+        p++;
+
+        // allow a trailing comma
+        if (p == end) break;
+
+        double value;
+        if (!urgParseNumber(p, end, value)) return URG_PARSE_MALFORMED;
+
+        if (nValues < maxValues) xy[nValues] = value;
+        nValues++;
+    }
+
+    if (nValues > maxValues) return URG_PARSE_LONG;
+    if (nValues % 2 != 0) return URG_PARSE_SHORT;
+    return URG_PARSE_OK;
+}
@@ -0,0 +1,30 @@
+//
+//  urgScanParser.h
+//  urg_capture_display
+//
+//  Parses CSV scan lines (time, x0, y0, x1, y1, ...) straight into float
+//  arrays, without splitting the line into strings.
+//
+
+#ifndef __urg_capture_display__urgScanParser__
+#define __urg_capture_display__urgScanParser__
+
+#include "ofMain.h"
+
+enum urgParseResult {
+    URG_PARSE_OK = 0,
+    URG_PARSE_SHORT,        // fewer values than expected (or an odd number of coordinates)
+    URG_PARSE_LONG,         // more values than fit in the output; extra values are ignored
+    URG_PARSE_MALFORMED     // a value is not a number
+};
+
+// parse a single number from [p, end), leaving p after it
+// returns false (and leaves p unchanged) if there is no number at p
+bool urgParseNumber(const char*& p, const char* end, double& value);
+
+// parse a csv scan line into its time and up to maxValues interleaved x/y values
+// nValues is set to the number of values on the line after the time (which is
+// more than maxValues if the result is URG_PARSE_LONG)
+urgParseResult urgParseScanLine(const char* begin, const char* end, double& time, float* xy, int maxValues, int& nValues);
+
+#endif /* defined(__urg_capture_display__urgScanParser__) */
@@ -0,0 +1,168 @@
+//
+//  urgScanPrefetcher.cpp
+//  urg_capture_display
+//
+//  Reads the scans just ahead of a playback position on a thread of its
+//  own, so playback takes them already parsed and never waits on the disk.
+//  Holds at most a fixed number of scans (one ring slot per scan index),
+//  ahead of the position in the direction playback is going.
+//
+
+#include "urgScanPrefetcher.h"
+
+urgScanPrefetcher::urgScanPrefetcher() {
+}
+
+// ---------------------------------------------------------------------
+
+urgScanPrefetcher::~urgScanPrefetcher() {
+
+    close();
+}
+
+// ---------------------------------------------------------------------
+
+void urgScanPrefetcher::setup(urgRecording* recording_, int capacity) {
+
+    close();
+
+    recording = recording_;
+    capacity = max(capacity, 1);
+    slots.assign(capacity, urgScan());
+    slotScans.assign(capacity, 0);
+    slotValid.assign(capacity, false);
+    slotReady.assign(capacity, false);
+    position = 0;
+    forward = true;
+    closing = false;
+    nReady = 0;
+    nMisses = 0;
+
+    startThread();
+}
+
+// ---------------------------------------------------------------------
+
+void urgScanPrefetcher::close() {
+
+    if (!isThreadRunning()) return;
+    {
+        std::unique_lock<std::mutex> lock(slotMutex);
+        closing = true;
+    }
+    positionChanged.notify_all();
+    waitForThread(true);
+}
+
+// ---------------------------------------------------------------------
+
+void urgScanPrefetcher::seek(unsigned long scan, bool forward_) {
+
+    {
+        std::unique_lock<std::mutex> lock(slotMutex);
+        if (scan == position && forward_ == forward) return;
+        position = scan;
+        forward = forward_;
+    }
+    positionChanged.notify_one();
+}
+
+// ---------------------------------------------------------------------
+
+bool urgScanPrefetcher::take(unsigned long i, urgScan& scan, bool& valid) {
+
+    {
+        std::unique_lock<std::mutex> lock(slotMutex);
+        size_t s = slots.empty() ? 0 : i % slots.size();
+        if (slots.empty() || !slotReady[s] || slotScans[s] != i) {
+            nMisses++;
+            return false;
+        }
+
+        // the caller's buffers go back into the slot to be reused
+        swap(scan, slots[s]);
+        valid = slotValid[s];
+        slotReady[s] = false;
+        nReady--;
+
+        // playback is past it now, so it's not read again
+        if (forward && i >= position) position = i + 1;
+        if (!forward && i <= position && i > 0) position = i - 1;
+    }
+
+    // a slot is free for the next scan along
+    positionChanged.notify_one();
+    return true;
+}
+
+// ---------------------------------------------------------------------
+
+int urgScanPrefetcher::getNumReady() {
+    std::unique_lock<std::mutex> lock(slotMutex);
+    return nReady;
+}
+
+unsigned long urgScanPrefetcher::getMisses() {
+    std::unique_lock<std::mutex> lock(slotMutex);
+    return nMisses;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgScanPrefetcher::wanted(unsigned long i) {
+
+    unsigned long nScans = recording->getNumScans();
+    if (i >= nScans) return false;
+    if (forward) return i >= position && i - position < slots.size();
+    return i <= position && position - i < slots.size();
+}
+
+// ---------------------------------------------------------------------
+
+bool urgScanPrefetcher::findUnread(unsigned long& i) {
+
+    // nearest first, so the scan playback needs next is read first
+    for (size_t k = 0; k < slots.size(); k++) {
+        if (!forward && k > position) return false;
+        i = forward ? position + k : position - k;
+        if (!wanted(i)) return false;
+        size_t s = i % slots.size();
+        if (!slotReady[s] || slotScans[s] != i) return true;
+    }
+    return false;
+}
+
+// ---------------------------------------------------------------------
+
+void urgScanPrefetcher::threadedFunction() {
+
+    // scan being read; swapped with a slot, so buffers are reused
+    urgScan scan;
+
+    while (true) {
+
+        unsigned long i;
+        {
+            std::unique_lock<std::mutex> lock(slotMutex);
+            positionChanged.wait(lock, [&]{ return closing || findUnread(i); });
+            if (closing) break;
+        }
+
+        // read without the lock, so playback can take scans meanwhile
+        // (readScan doesn't move the recording's read position)
+        bool valid = recording->readScan(i, scan, false) != URG_PARSE_MALFORMED;
+
+        std::unique_lock<std::mutex> lock(slotMutex);
+
+        // playback moved on while the scan was read
+        if (!wanted(i)) continue;
+
+        // the slot's scan (if any) is no longer wanted: i is in its place
+        size_t s = i % slots.size();
+        if (!slotReady[s]) nReady++;
+        swap(scan, slots[s]);
+        slotScans[s] = i;
+        slotValid[s] = valid;
+        slotReady[s] = true;
+    }
+}
@@ -0,0 +1,76 @@
+//
+//  urgScanPrefetcher.h
+//  urg_capture_display
+//
+//  Reads the scans just ahead of a playback position on a thread of its
+//  own, so playback takes them already parsed and never waits on the disk.
+//  Holds at most a fixed number of scans (one ring slot per scan index),
+//  ahead of the position in the direction playback is going.
+//
+
+#ifndef __urg_capture_display__urgScanPrefetcher__
+#define __urg_capture_display__urgScanPrefetcher__
+
+#include "ofMain.h"
+#include "urgRecording.h"
+
+class urgScanPrefetcher : public ofThread {
+
+public:
+
+    urgScanPrefetcher();
+    ~urgScanPrefetcher();
+
+    // start reading scans of recording (which must stay loaded until close()),
+    // holding up to capacity of them
+    void setup(urgRecording* recording, int capacity = 256);
+
+    // stop the thread and forget the scans read
+    void close();
+
+    // the next scan playback will take, and which way it's going; scans from
+    // there up to capacity further on are read, and any others dropped
+    void seek(unsigned long scan, bool forward);
+
+    // take scan i if it's been read (valid is false for a malformed csv line),
+    // which moves the position past it; returns false if it hasn't been read yet
+    bool take(unsigned long i, urgScan& scan, bool& valid);
+
+    // scans read and not taken yet
+    int getNumReady();
+
+    // times take() found its scan not read yet
+    unsigned long getMisses();
+
+private:
+
+    void threadedFunction();
+
+    // whether scan i is one the thread should read (call with the lock held)
+    bool wanted(unsigned long i);
+
+    // the nearest wanted scan not read yet; false if they're all read
+    bool findUnread(unsigned long& i);
+
+    urgRecording* recording = NULL;
+
+    std::mutex slotMutex;
+    std::condition_variable positionChanged;
+
+    // slot i % capacity holds scan slotScans[i % capacity] once slotReady
+    vector<urgScan> slots;
+    vector<unsigned long> slotScans;
+    vector<bool> slotValid;
+    vector<bool> slotReady;
+
+    // the position and direction given to seek()
+    unsigned long position = 0;
+    bool forward = true;
+
+    bool closing = false;
+    int nReady = 0;
+    unsigned long nMisses = 0;
+
+};
+
+#endif /* defined(__urg_capture_display__urgScanPrefetcher__) */
@@ -0,0 +1,183 @@
+//
+//  urgVoxelGrid.cpp
+//  urg_display
+//
+//  Downsamples a point cloud to one point per cell of a regular grid.
+//  Cells are found through a hash of their integer coordinates (so empty
+//  space costs nothing), split across threads by hash, and each kept cell
+//  becomes either the centroid of its points or the first point that fell
+//  in it. Cells come out in the order their first point had in the input.
+//
+
+#include "urgVoxelGrid.h"
+#include "urgParallel.h"
+
+// bits per cell coordinate in a packed key (cells further than 2^20 from the
+// origin wrap around, which is kilometers away at any useful cell size)
+#define URG_VOXEL_COORD_BITS 21
+#define URG_VOXEL_EMPTY_KEY (~(uint64_t)0)
+
+// the integer coordinates of a point's cell, packed into one key
+static inline uint64_t cellKey(const ofVec3f& p, float invCellSize) {
+
+    const uint64_t mask = (1 << URG_VOXEL_COORD_BITS) - 1;
+    const int64_t bias = 1 << (URG_VOXEL_COORD_BITS - 1);
+    uint64_t x = ((int64_t)floor(p.x * invCellSize) + bias) & mask;
+    uint64_t y = ((int64_t)floor(p.y * invCellSize) + bias) & mask;
+    uint64_t z = ((int64_t)floor(p.z * invCellSize) + bias) & mask;
+    return (x << (2 * URG_VOXEL_COORD_BITS)) | (y << URG_VOXEL_COORD_BITS) | z;
+}
+
+static inline uint64_t hashKey(uint64_t key) {
+    key *= 0x9E3779B97F4A7C15ULL;
+    return key ^ (key >> 29);
+}
+
+// ---------------------------------------------------------------------
+
+// the points that fell in one cell
+struct voxelCell {
+    double x, y, z;
+    size_t count;
+    size_t first;
+};
+
+// cells of one thread's share of the keys, in an open-addressed table
+struct voxelTable {
+
+    vector<uint64_t> keys;
+    vector<size_t> slots;   // index into cells
+    vector<voxelCell> cells;
+    size_t mask = 0;
+
+    voxelTable() {
+        resize(1 << 12);
+    }
+
+    void resize(size_t capacity) {
+        keys.assign(capacity, URG_VOXEL_EMPTY_KEY);
+        slots.assign(capacity, 0);
+        mask = capacity - 1;
+    }
+
+    // the cell with a key, added if it's new
+    voxelCell& find(uint64_t key, uint64_t hash, size_t first) {
+
+        size_t s = hash & mask;
+        while (keys[s] != key) {
+            if (keys[s] == URG_VOXEL_EMPTY_KEY) {
+
+                // keep the table at most half full
+                if (2 * (cells.size() + 1) > keys.size()) {
+                    grow();
+                    return find(key, hash, first);
+                }
+                keys[s] = key;
+                slots[s] = cells.size();
+                voxelCell cell = { 0, 0, 0, 0, first };
+                cells.push_back(cell);
+                break;
+            }
+            s = (s + 1) & mask;
+        }
+        return cells[slots[s]];
+    }
+
+    void grow() {
+
+        vector<uint64_t> oldKeys;
+        vector<size_t> oldSlots;
+        oldKeys.swap(keys);
+        oldSlots.swap(slots);
+        resize(2 * oldKeys.size());
+
+        for (size_t i = 0; i < oldKeys.size(); i++) {
+            if (oldKeys[i] == URG_VOXEL_EMPTY_KEY) continue;
+            size_t s = hashKey(oldKeys[i]) & mask;
+            while (keys[s] != URG_VOXEL_EMPTY_KEY) s = (s + 1) & mask;
+            keys[s] = oldKeys[i];
+            slots[s] = oldSlots[i];
+        }
+    }
+};
+
+// ---------------------------------------------------------------------
+
+size_t urgVoxelDownsample(const ofMesh& in, ofMesh& out, float cellSize, urgVoxelMode mode) {
+
+    const vector<ofVec3f>& points = in.getVertices();
+    size_t n = points.size();
+    if (cellSize <= 0 || n == 0) {
+        if (&out != &in) out = in;
+        return n;
+    }
+    float invCellSize = 1. / cellSize;
+
+    // key of every point's cell, and each chunk's points sorted by the share
+    // of the keys (by hash) their cell belongs to, so no thread has to look
+    // through every point for its own
+    int nParts = urgNumChunks(n, 1 << 16);
+    vector<uint64_t> keys(n);
+    vector<uint64_t> hashes(n);
+    vector<vector<size_t> > buckets(nParts * nParts);
+    urgParallelFor(n, [&](int chunk, size_t begin, size_t end) {
+        vector<size_t>* chunkBuckets = &buckets[chunk * nParts];
+        for (int part = 0; part < nParts; part++) chunkBuckets[part].reserve((end - begin) / nParts + 1);
+        for (size_t i = begin; i < end; i++) {
+            keys[i] = cellKey(points[i], invCellSize);
+            hashes[i] = hashKey(keys[i]);
+            chunkBuckets[(hashes[i] >> 48) % nParts].push_back(i);
+        }
+    }, 1 << 16);
+
+    // each thread collects the cells in its share, taking the chunks' points
+    // in order so cells still see their points in input order
+    vector<voxelTable> tables(nParts);
+    urgParallelFor(nParts, [&](int chunk, size_t begin, size_t end) {
+        for (size_t part = begin; part < end; part++) {
+            voxelTable& table = tables[part];
+            for (int c = 0; c < nParts; c++) {
+                const vector<size_t>& bucket = buckets[c * nParts + part];
+                for (size_t b = 0; b < bucket.size(); b++) {
+                    size_t i = bucket[b];
+                    voxelCell& cell = table.find(keys[i], hashes[i], i);
+                    cell.x += points[i].x;
+                    cell.y += points[i].y;
+                    cell.z += points[i].z;
+                    cell.count++;
+                }
+            }
+        }
+    });
+
+    // order the cells by their first point
+    vector<const voxelCell*> cells;
+    for (int part = 0; part < nParts; part++) {
+        for (size_t c = 0; c < tables[part].cells.size(); c++) cells.push_back(&tables[part].cells[c]);
+    }
+    sort(cells.begin(), cells.end(), [](const voxelCell* a, const voxelCell* b) { return a->first < b->first; });
+
+    // one point (and color) per cell
+    size_t nCells = cells.size();
+    vector<ofVec3f> kept(nCells);
+    vector<ofFloatColor> keptColors;
+    const vector<ofFloatColor>& colors = in.getColors();
+    bool withColors = (colors.size() == n);
+    if (withColors) keptColors.resize(nCells);
+
+    urgParallelFor(nCells, [&](int chunk, size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            const voxelCell& cell = *cells[c];
+            if (mode == URG_VOXEL_CENTROID) kept[c] = ofVec3f(cell.x / cell.count, cell.y / cell.count, cell.z / cell.count);
+            else kept[c] = points[cell.first];
+            if (withColors) keptColors[c] = colors[cell.first];
+        }
+    }, 1 << 16);
+
+    // (in and out may be the same mesh, so it's only touched now)
+    out.getVertices().swap(kept);
+    out.getColors().swap(keptColors);
+
+    ofLogNotice("urgVoxelGrid") << n << " points to " << nCells << " in " << cellSize << " mm cells (" << (nCells > 0 ? (double)n / nCells : 0) << "x reduction)";
+    return nCells;
+}
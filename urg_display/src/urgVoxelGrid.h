@@ -0,0 +1,28 @@
+//
+//  urgVoxelGrid.h
+//  urg_display
+//
+//  Downsamples a point cloud to one point per cell of a regular grid.
+//  Cells are found through a hash of their integer coordinates (so empty
+//  space costs nothing), split across threads by hash, and each kept cell
+//  becomes either the centroid of its points or the first point that fell
+//  in it. Cells come out in the order their first point had in the input.
+//
+
+#ifndef __urg_display__urgVoxelGrid__
+#define __urg_display__urgVoxelGrid__
+
+#include "ofMain.h"
+
+// what a cell keeps
+enum urgVoxelMode {
+    URG_VOXEL_CENTROID = 0,     // the mean of its points
+    URG_VOXEL_FIRST = 1         // its first point
+};
+
+// downsample a mesh's points (and colors, if it has them: each cell keeps its
+// first point's color) into cells of cellSize (mm) on a side; out may be in
+// returns the number of points kept
+size_t urgVoxelDownsample(const ofMesh& in, ofMesh& out, float cellSize, urgVoxelMode mode = URG_VOXEL_CENTROID);
+
+#endif /* defined(__urg_display__urgVoxelGrid__) */
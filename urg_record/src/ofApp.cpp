@@ -13,8 +13,9 @@ void ofApp::setup(){
     // load last settings used
     panel.loadFromFile("settings.xml");
     
-    // start listening over osc to port 7777
-    rec.setup(7777);
+    // start listening over osc to each of the sensor ports (7777 unless
+    // settings.xml lists others)
+    rec.setup();
     
 }
 
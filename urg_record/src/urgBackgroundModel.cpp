@@ -0,0 +1,111 @@
+//
+//  urgBackgroundModel.cpp
+//  urg_record
+//
+//  A running model of what each beam of a sensor sees when nothing is in
+//  the way, for picking out what's in front of it (people, mostly). Each
+//  beam keeps an approximate median of its range, which moves at most a
+//  fixed step towards every new range (so noise and passers-by hardly move
+//  it, and whatever stays put long enough becomes background), and the mean
+//  absolute deviation of its ranges from the median. A beam is foreground
+//  when its range is nearer than the median by more than a minimum distance
+//  and a number of deviations. The model is kept in sixteenths of a mm, so
+//  the per-scan update is integer only and branch-free (selects are masks),
+//  which the compiler vectorizes.
+//
+
+#include "urgBackgroundModel.h"
+
+// each new range moves a beam's mean absolute deviation 1 / 2^bits of the way
+#define URG_BACKGROUND_DEVIATION_BITS 4
+
+// mm to fixed point and back
+static inline int32_t toFixed(float v) {
+    return (int32_t)(v * (1 << URG_BACKGROUND_FRACTION_BITS) + 0.5f);
+}
+
+static inline float fromFixed(int32_t v) {
+    return v / (float)(1 << URG_BACKGROUND_FRACTION_BITS);
+}
+
+// ---------------------------------------------------------------------
+
+void urgBackgroundModel::setup(float step_, float minDistance_, float deviations_) {
+
+    step = toFixed(max(step_, 0.f));
+    minDistance = toFixed(max(minDistance_, 0.f));
+    nDeviations = toFixed(max(deviations_, 0.f));
+}
+
+// ---------------------------------------------------------------------
+
+void urgBackgroundModel::clear() {
+
+    medians.clear();
+    deviations.clear();
+    nScans = 0;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgBackgroundModel::isLearned() {
+    return nScans >= (unsigned long)max(learnScans, 0);
+}
+
+int urgBackgroundModel::getNumBeams() {
+    return medians.size();
+}
+
+float urgBackgroundModel::getMedian(int beam) {
+    return fromFixed(medians[beam]);
+}
+
+float urgBackgroundModel::getDeviation(int beam) {
+    return fromFixed(deviations[beam]);
+}
+
+// ---------------------------------------------------------------------
+
+int urgBackgroundModel::apply(const int32_t* ranges, int nBeams, uint8_t* foreground) {
+
+    // a sensor with a different beam count is a different sensor
+    if (nBeams != (int)medians.size()) {
+        medians.assign(nBeams, 0);
+        deviations.assign(nBeams, 0);
+        nScans = 0;
+    }
+
+    int32_t* m = medians.data();
+    int32_t* d = deviations.data();
+    int32_t learned = isLearned() ? -1 : 0;
+    int32_t stepSize = step;
+    int32_t distance = minDistance;
+    int32_t deviationScale = nDeviations;
+    int nForeground = 0;
+
+    // masks are all ones or all zeros
+    for (int i = 0; i < nBeams; i++) {
+
+        int32_t range = ranges[i] * (1 << URG_BACKGROUND_FRACTION_BITS);
+        int32_t valid = -(int32_t)(ranges[i] >= URG_BACKGROUND_MIN_RANGE);
+
+        // a beam's first return starts its median
+        int32_t unset = -(int32_t)(m[i] == 0);
+        int32_t median = m[i] ^ ((m[i] ^ range) & unset & valid);
+        int32_t difference = range - median;
+
+        // nearer than the background by enough (ranges that aren't returns never are)
+        int32_t threshold = max(distance, (d[i] * deviationScale) >> URG_BACKGROUND_FRACTION_BITS);
+        int32_t isForeground = valid & learned & -(int32_t)(difference + threshold < 0);
+        foreground[i] = isForeground & 1;
+        nForeground += isForeground & 1;
+
+        // foreground doesn't count towards how much the background varies
+        int32_t deviation = d[i] + ((abs(difference) - d[i] + (1 << (URG_BACKGROUND_DEVIATION_BITS - 1))) >> URG_BACKGROUND_DEVIATION_BITS);
+        d[i] ^= (d[i] ^ deviation) & valid & ~isForeground;
+        m[i] = median + (min(max(difference, -stepSize), stepSize) & valid);
+    }
+
+    nScans++;
+    return nForeground;
+}
@@ -0,0 +1,70 @@
+//
+//  urgBackgroundModel.h
+//  urg_record
+//
+//  A running model of what each beam of a sensor sees when nothing is in
+//  the way, for picking out what's in front of it (people, mostly). Each
+//  beam keeps an approximate median of its range, which moves at most a
+//  fixed step towards every new range (so noise and passers-by hardly move
+//  it, and whatever stays put long enough becomes background), and the mean
+//  absolute deviation of its ranges from the median. A beam is foreground
+//  when its range is nearer than the median by more than a minimum distance
+//  and a number of deviations. The model is kept in sixteenths of a mm, so
+//  the per-scan update is integer only and branch-free (selects are masks),
+//  which the compiler vectorizes.
+//
+
+#ifndef __urg_record__urgBackgroundModel__
+#define __urg_record__urgBackgroundModel__
+
+#include "ofMain.h"
+
+// ranges under this (mm) are the sensor's error codes, not returns
+#define URG_BACKGROUND_MIN_RANGE 20
+
+// fractional bits of the model's fixed point values
+#define URG_BACKGROUND_FRACTION_BITS 4
+
+class urgBackgroundModel {
+
+public:
+
+    // step: mm the median moves per scan at most (how quickly what stops
+    // moving becomes background)
+    // minDistance, deviations: how much nearer than the median (mm, and in
+    // deviations) a range has to be to be foreground
+    void setup(float step = 5, float minDistance = 100, float deviations = 4);
+
+    // forget the model; the next scan starts it again
+    void clear();
+
+    // update the model with a scan of ranges (mm), and set foreground[i] to 1
+    // for the beams in front of the background (0 for the rest); nothing is
+    // foreground until the model has seen learnScans scans
+    // returns the number of foreground beams
+    int apply(const int32_t* ranges, int nBeams, uint8_t* foreground);
+
+    bool isLearned();
+    int getNumBeams();
+
+    // scans the model takes to learn the background before flagging anything
+    int learnScans = 50;
+
+    // a beam's median range and mean absolute deviation (mm)
+    float getMedian(int beam);
+    float getDeviation(int beam);
+
+private:
+
+    // the settings, in fixed point
+    int32_t step = 5 << URG_BACKGROUND_FRACTION_BITS;
+    int32_t minDistance = 100 << URG_BACKGROUND_FRACTION_BITS;
+    int32_t nDeviations = 4 << URG_BACKGROUND_FRACTION_BITS;
+
+    vector<int32_t> medians;
+    vector<int32_t> deviations;
+    unsigned long nScans = 0;
+
+};
+
+#endif /* defined(__urg_record__urgBackgroundModel__) */
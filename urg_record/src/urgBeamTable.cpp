@@ -0,0 +1,119 @@
+//
+//  urgBeamTable.cpp
+//  urg_record
+//
+//  Cached sin/cos of a sensor's beam angles. The angles are fixed by the
+//  sensor's angular resolution, so they're learned from the first scan (or
+//  configured) and every later scan is converted to cartesian coordinates
+//  with a multiply per beam instead of a cos and a sin.
+//
+
+#include "urgBeamTable.h"
+
+// angles further than this (radians) from the table don't match it
+#define URG_BEAM_ANGLE_TOLERANCE 1e-5
+
+// after this many mismatching scans in a row the sensor's angles are learned again
+#define URG_BEAM_RELEARN_SCANS 10
+
+void urgBeamTable::configure(int nBeams, float startAngle, float angularResolution) {
+
+    vector<float> theta(nBeams);
+    for (int i = 0; i < nBeams; i++) theta[i] = startAngle + i * angularResolution;
+    learn(theta.data(), nBeams);
+}
+
+// ---------------------------------------------------------------------
+
+void urgBeamTable::clear() {
+
+    angles.clear();
+    cosines.clear();
+    sines.clear();
+    nMismatched = 0;
+    nMismatchedInARow = 0;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgBeamTable::isSet() {
+    return !angles.empty();
+}
+
+// ---------------------------------------------------------------------
+
+int urgBeamTable::getNumBeams() {
+    return angles.size();
+}
+
+// ---------------------------------------------------------------------
+
+unsigned long urgBeamTable::getMismatchedScans() {
+    return nMismatched;
+}
+
+// ---------------------------------------------------------------------
+
+void urgBeamTable::learn(const float* theta, int nBeams) {
+
+    angles.assign(theta, theta + nBeams);
+    cosines.resize(nBeams);
+    sines.resize(nBeams);
+    for (int i = 0; i < nBeams; i++) {
+        cosines[i] = cos(theta[i]);
+        sines[i] = sin(theta[i]);
+    }
+    nMismatchedInARow = 0;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgBeamTable::matches(const float* theta, int nBeams) {
+
+    if (nBeams != (int)angles.size()) return false;
+
+    // branch-free so the compiler can vectorize it
+    int nOff = 0;
+    const float* table = angles.data();
+    for (int i = 0; i < nBeams; i++) {
+        nOff += fabs(theta[i] - table[i]) > URG_BEAM_ANGLE_TOLERANCE;
+    }
+    return nOff == 0;
+}
+
+// ---------------------------------------------------------------------
+
+void urgBeamTable::convert(const int32_t* r, const float* theta, int nBeams, float* xy) {
+
+    if (!isSet()) learn(theta, nBeams);
+
+    if (!matches(theta, nBeams)) {
+
+        nMismatched++;
+        nMismatchedInARow++;
+
+        // the sensor has changed: take its angles from now on
+        if (nMismatchedInARow >= URG_BEAM_RELEARN_SCANS) {
+            ofLogNotice("urgBeamTable") << "beam angles changed; learning " << nBeams << " new angles";
+            learn(theta, nBeams);
+        }
+        else {
+            // convert this scan the slow way
+            for (int i = 0; i < nBeams; i++) {
+                xy[2 * i] = r[i] * cos(theta[i]);
+                xy[2 * i + 1] = r[i] * sin(theta[i]);
+            }
+            return;
+        }
+    }
+    nMismatchedInARow = 0;
+
+    // polar to cartesian with the cached sin/cos
+    const float* c = cosines.data();
+    const float* s = sines.data();
+    for (int i = 0; i < nBeams; i++) {
+        float range = r[i];
+        xy[2 * i] = range * c[i];
+        xy[2 * i + 1] = range * s[i];
+    }
+}
@@ -0,0 +1,54 @@
+//
+//  urgBeamTable.h
+//  urg_record
+//
+//  Cached sin/cos of a sensor's beam angles. The angles are fixed by the
+//  sensor's angular resolution, so they're learned from the first scan (or
+//  configured) and every later scan is converted to cartesian coordinates
+//  with a multiply per beam instead of a cos and a sin.
+//
+
+#ifndef __urg_record__urgBeamTable__
+#define __urg_record__urgBeamTable__
+
+#include "ofMain.h"
+
+class urgBeamTable {
+
+public:
+
+    // set the table from a sensor's geometry instead of learning it from a scan
+    void configure(int nBeams, float startAngle, float angularResolution);
+
+    // forget the table; the next scan sets it again
+    void clear();
+
+    bool isSet();
+    int getNumBeams();
+
+    // convert a scan of ranges (mm) and angles (radians) to interleaved x/y (mm)
+    // scans whose angles don't match the table are converted directly; a sensor
+    // that keeps sending different angles replaces the table
+    void convert(const int32_t* r, const float* theta, int nBeams, float* xy);
+
+    // scans that didn't match the table
+    unsigned long getMismatchedScans();
+
+private:
+
+    // learn the table from a scan's angles
+    void learn(const float* theta, int nBeams);
+
+    // whether a scan's angles match the table
+    bool matches(const float* theta, int nBeams);
+
+    vector<float> angles;
+    vector<float> cosines;
+    vector<float> sines;
+
+    unsigned long nMismatched = 0;
+    int nMismatchedInARow = 0;
+
+};
+
+#endif /* defined(__urg_record__urgBeamTable__) */
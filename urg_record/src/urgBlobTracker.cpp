@@ -0,0 +1,179 @@
+//
+//  urgBlobTracker.cpp
+//  urg_record
+//
+//  Follows blobs (people, mostly) from scan to scan, in place of the
+//  external tracker that used to send /urg/tracker/data. Each scan is cut
+//  into blobs in one pass over its beams: a blob runs on while each return
+//  is close to the one before it. Blobs are matched to the tracks of the
+//  scans before, nearest to where each track was heading first, and tracks
+//  keep their id for as long as they keep being matched. Blobs and tracks
+//  are capped per scan and their storage is reused, so every scan takes a
+//  bounded amount of work and no allocation.
+//
+
+#include "urgBlobTracker.h"
+#include "urgBackgroundModel.h"
+
+// how much of a track's velocity comes from its last move (the rest is the
+// velocity it had), which smooths out the jitter of blob centroids
+#define URG_TRACK_VELOCITY_WEIGHT 0.5f
+
+void urgBlobTracker::setup(int firstId, int idStep_) {
+
+    nextId = firstId;
+    idStep = max(idStep_, 1);
+    clear();
+}
+
+// ---------------------------------------------------------------------
+
+void urgBlobTracker::clear() {
+
+    blobs.clear();
+    tracks.clear();
+    started = false;
+
+    // room for the most there can be, so updates never allocate
+    blobs.reserve(maxBlobs);
+    tracks.reserve(maxTracks);
+    candidates.reserve((size_t)maxBlobs * maxTracks);
+    blobMatched.reserve(maxBlobs);
+    trackMatched.reserve(maxTracks);
+}
+
+// ---------------------------------------------------------------------
+
+const vector<urgBlob>& urgBlobTracker::getBlobs() {
+    return blobs;
+}
+
+const vector<urgTrack>& urgBlobTracker::getTracks() {
+    return tracks;
+}
+
+bool urgBlobTracker::isReported(const urgTrack& track) {
+    return track.missed == 0 && track.hits >= confirmScans;
+}
+
+// ---------------------------------------------------------------------
+
+int urgBlobTracker::update(unsigned long time, const int32_t* ranges, const float* xy, int nBeams, const uint8_t* mask) {
+
+    // cut the scan into blobs
+    blobs.clear();
+    float maxSquared = blobDistance * blobDistance;
+    int first = -1, last = -1, count = 0;
+    float sumX = 0, sumY = 0;
+    for (int i = 0; i < nBeams; i++) {
+
+        if (ranges[i] < URG_BACKGROUND_MIN_RANGE || (mask != NULL && !mask[i])) continue;
+        float x = xy[2 * i];
+        float y = xy[2 * i + 1];
+
+        // a return too far along or away from the last one starts a new blob
+        if (last < 0 || i - last - 1 > maxGapBeams || ofVec2f(x, y).squareDistance(ofVec2f(xy[2 * last], xy[2 * last + 1])) > maxSquared) {
+            if (last >= 0) endBlob(first, last, xy, sumX, sumY, count);
+            first = i;
+            sumX = sumY = 0;
+            count = 0;
+        }
+        sumX += x;
+        sumY += y;
+        count++;
+        last = i;
+    }
+    if (last >= 0) endBlob(first, last, xy, sumX, sumY, count);
+
+    // match them to the tracks
+    float seconds = started && time > lastTime ? (time - lastTime) / 1000.f : 0;
+    lastTime = time;
+    started = true;
+    match(seconds);
+
+    int nReported = 0;
+    for (size_t t = 0; t < tracks.size(); t++) nReported += isReported(tracks[t]);
+    return nReported;
+}
+
+// ---------------------------------------------------------------------
+
+void urgBlobTracker::endBlob(int first, int last, const float* xy, float sumX, float sumY, int count) {
+
+    if (count < minBlobBeams || (int)blobs.size() >= maxBlobs) return;
+
+    urgBlob blob;
+    blob.centroid.set(sumX / count, sumY / count);
+    blob.width = ofVec2f(xy[2 * first], xy[2 * first + 1]).distance(ofVec2f(xy[2 * last], xy[2 * last + 1]));
+    blob.firstBeam = first;
+    blob.nBeams = last - first + 1;
+    blobs.push_back(blob);
+}
+
+// ---------------------------------------------------------------------
+
+void urgBlobTracker::match(float seconds) {
+
+    // every pair close enough, nearest first, each track to the blob nearest
+    // where it was heading (greedily, which is exact unless blobs crowd together)
+    candidates.clear();
+    float maxSquared = matchDistance * matchDistance;
+    for (size_t t = 0; t < tracks.size(); t++) {
+        ofVec2f predicted = tracks[t].position + tracks[t].velocity * seconds;
+        for (size_t b = 0; b < blobs.size(); b++) {
+            float distance = predicted.squareDistance(blobs[b].centroid);
+            if (distance > maxSquared) continue;
+            candidate c = { distance, (int)t, (int)b };
+            candidates.push_back(c);
+        }
+    }
+    sort(candidates.begin(), candidates.end());
+
+    blobMatched.assign(blobs.size(), false);
+    trackMatched.assign(tracks.size(), false);
+    for (size_t c = 0; c < candidates.size(); c++) {
+
+        const candidate& pair = candidates[c];
+        if (trackMatched[pair.track] || blobMatched[pair.blob]) continue;
+        trackMatched[pair.track] = true;
+        blobMatched[pair.blob] = true;
+
+        urgTrack& track = tracks[pair.track];
+        const urgBlob& blob = blobs[pair.blob];
+        if (seconds > 0) {
+            ofVec2f velocity = (blob.centroid - track.position) / seconds;
+            track.velocity = track.velocity * (1 - URG_TRACK_VELOCITY_WEIGHT) + velocity * URG_TRACK_VELOCITY_WEIGHT;
+        }
+        track.position = blob.centroid;
+        track.width = blob.width;
+        track.hits++;
+        track.missed = 0;
+    }
+
+    // tracks that weren't matched coast along, until they've been missing too long
+    size_t nKept = 0;
+    for (size_t t = 0; t < tracks.size(); t++) {
+        urgTrack& track = tracks[t];
+        if (!trackMatched[t]) {
+            track.position += track.velocity * seconds;
+            track.missed++;
+            if (track.missed > maxMissedScans) continue;
+        }
+        tracks[nKept++] = track;
+    }
+    tracks.resize(nKept);
+
+    // blobs that weren't matched start tracks of their own
+    for (size_t b = 0; b < blobs.size() && (int)tracks.size() < maxTracks; b++) {
+        if (blobMatched[b]) continue;
+        urgTrack track;
+        track.id = nextId;
+        track.position = blobs[b].centroid;
+        track.velocity.set(0, 0);
+        track.width = blobs[b].width;
+        track.hits = 1;
+        track.missed = 0;
+        tracks.push_back(track);
+        nextId += idStep;
+    }
+}
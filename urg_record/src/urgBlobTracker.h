@@ -0,0 +1,99 @@
+//
+//  urgBlobTracker.h
+//  urg_record
+//
+//  Follows blobs (people, mostly) from scan to scan, in place of the
+//  external tracker that used to send /urg/tracker/data. Each scan is cut
+//  into blobs in one pass over its beams: a blob runs on while each return
+//  is close to the one before it. Blobs are matched to the tracks of the
+//  scans before, nearest to where each track was heading first, and tracks
+//  keep their id for as long as they keep being matched. Blobs and tracks
+//  are capped per scan and their storage is reused, so every scan takes a
+//  bounded amount of work and no allocation.
+//
+
+#ifndef __urg_record__urgBlobTracker__
+#define __urg_record__urgBlobTracker__
+
+#include "ofMain.h"
+
+// one run of adjacent returns in a scan
+struct urgBlob {
+    ofVec2f centroid;           // mm
+    float width;                // mm between its end points
+    int firstBeam;
+    int nBeams;                 // beams from its first to its last (gaps included)
+};
+
+// a blob followed from scan to scan
+struct urgTrack {
+    int id;
+    ofVec2f position;           // mm
+    ofVec2f velocity;           // mm / sec
+    float width;                // mm
+    int hits;                   // scans it's been matched in
+    int missed;                 // scans in a row it hasn't been
+};
+
+class urgBlobTracker {
+
+public:
+
+    // ids of new tracks are firstId, firstId + idStep, firstId + 2 * idStep ...
+    // (so trackers of several sensors can hand out ids that don't collide)
+    void setup(int firstId = 0, int idStep = 1);
+
+    // forget every track
+    void clear();
+
+    // cut a scan (ranges in mm, and their interleaved x/y) into blobs and
+    // match them to the tracks; beams with no return, or whose mask is 0 when
+    // a mask is given, aren't part of any blob
+    // returns the number of tracks reported for this scan
+    int update(unsigned long time, const int32_t* ranges, const float* xy, int nBeams, const uint8_t* mask = NULL);
+
+    // the last scan's blobs, and every track (reported or not)
+    const vector<urgBlob>& getBlobs();
+    const vector<urgTrack>& getTracks();
+
+    // whether a track is reported: seen in the last scan, and in enough scans
+    bool isReported(const urgTrack& track);
+
+    float blobDistance = 150;   // mm between neighbouring returns of a blob at most
+    int maxGapBeams = 2;        // beams without a return a blob can span
+    int minBlobBeams = 3;       // beams a blob has at least
+    float matchDistance = 500;  // mm from where a track was heading a blob can be and still match it
+    int confirmScans = 3;       // scans a track has to be matched in before it's reported
+    int maxMissedScans = 5;     // scans in a row a track can go unmatched before it's dropped
+    int maxBlobs = 64;          // blobs per scan at most (the rest are ignored)
+    int maxTracks = 128;        // tracks at most (no new ones start past it)
+
+private:
+
+    // close the blob being built, keeping it if it's big enough
+    void endBlob(int first, int last, const float* xy, float sumX, float sumY, int count);
+
+    void match(float seconds);
+
+    vector<urgBlob> blobs;
+    vector<urgTrack> tracks;
+
+    // possible matches, as (squared distance, track, blob)
+    struct candidate {
+        float distance;
+        int track;
+        int blob;
+        bool operator<(const candidate& other) const { return distance < other.distance; }
+    };
+    vector<candidate> candidates;
+    vector<bool> blobMatched;
+    vector<bool> trackMatched;
+
+    int nextId = 0;
+    int idStep = 1;
+    unsigned long lastTime = 0;
+    bool started = false;
+
+};
+
+#endif /* defined(__urg_record__urgBlobTracker__) */
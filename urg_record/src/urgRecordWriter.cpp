@@ -0,0 +1,542 @@
+//
+//  urgRecordWriter.cpp
+//  urg_record
+//
+//  Writes scans to a recording file on a background thread, so a slow
+//  disk never stalls the main thread that drains OSC messages.
+//  Scans are handed over through a bounded queue of preallocated buffers.
+//  Compressed recordings are encoded a chunk at a time on the same thread,
+//  so up to a chunk of scans is only on disk once it's complete.
+//  Disk space is reserved ahead of what's written, and long recordings can
+//  be split into segments of bounded size or duration (see urgFormat.h).
+//
+
+#include "urgRecordWriter.h"
+
+#ifndef TARGET_WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// formatted data is written to disk in blocks of this size, aligned in the file
+#define URG_WRITE_BLOCK_SIZE (1 << 20)
+
+// ...unless it has waited this long (microseconds), when whatever there is gets written
+#define URG_WRITE_MAX_DELAY 2000000
+
+// disk is reserved this far ahead of what's written for files without a size limit
+#define URG_RESERVE_STEP (64 << 20)
+
+// ---------------------------------------------------------------------
+
+// reserve disk for bytes [offset, offset + length) of a file without changing
+// its size, so appending to it doesn't scatter it in small pieces over the disk
+static bool urgReserve(string path, uint64_t offset, uint64_t length) {
+
+#ifdef TARGET_WIN32
+    return false;
+#else
+    int fd = ::open(path.c_str(), O_WRONLY);
+    if (fd < 0) return false;
+#ifdef TARGET_OSX
+    // contiguous if possible, past whatever is allocated already
+    fstore_t store = { F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0, (off_t)length, 0 };
+    bool ok = fcntl(fd, F_PREALLOCATE, &store) != -1;
+    if (!ok) {
+        store.fst_flags = F_ALLOCATEALL;
+        ok = fcntl(fd, F_PREALLOCATE, &store) != -1;
+    }
+#else
+    bool ok = fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, length) == 0;
+#endif
+    ::close(fd);
+    return ok;
+#endif
+}
+
+// give back the disk reserved past the end of a finished file
+static void urgTrim(string path, uint64_t size) {
+
+#ifndef TARGET_WIN32
+    if (truncate(path.c_str(), size) != 0) {
+        ofLogWarning("urgRecordWriter") << "could not release the space reserved for " << path;
+    }
+#endif
+}
+
+urgRecordWriter::urgRecordWriter() {
+
+    queueDepth = 0;
+    maxQueueDepth = 0;
+    droppedScans = 0;
+    writtenScans = 0;
+    failed = false;
+    statsEnabled = false;
+    segment = 0;
+    memset(&header, 0, sizeof(header));
+}
+
+// ---------------------------------------------------------------------
+
+urgRecordWriter::~urgRecordWriter() {
+
+    close();
+}
+
+// ---------------------------------------------------------------------
+
+void urgRecordWriter::setup(int capacity_, urgQueuePolicy policy_, int nBeams) {
+
+    capacity = max(capacity_, 1);
+    policy = policy_;
+    slotBeams = nBeams;
+}
+
+// ---------------------------------------------------------------------
+
+void urgRecordWriter::setSegments(uint64_t maxBytes, unsigned long maxMillis) {
+
+    segmentMaxBytes = maxBytes;
+    segmentMaxMillis = maxMillis;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgRecordWriter::open(string fileName_, urgRecordingFormat format_, uint64_t sessionId_) {
+
+    if (opened) close();
+
+    format = format_;
+    keepRanges = (format == URG_FORMAT_COMPRESSED || format == URG_FORMAT_POLAR);
+    fileName = fileName_;
+
+    // a segmented recording's files are named after it and share a session id
+    bool segmented = segmentMaxBytes > 0 || segmentMaxMillis > 0;
+    sessionId = !segmented ? 0 : (sessionId_ != 0) ? sessionId_ : urgMakeSessionId();
+    segment = 0;
+    segmentStarted = false;
+    if (!openFile()) return false;
+
+    // preallocate every slot so pushing a scan never allocates
+    slots.resize(capacity);
+    for (size_t i = 0; i < slots.size(); i++) {
+        slots[i].xy.reserve(2 * slotBeams);
+        if (keepRanges) slots[i].ranges.reserve(slotBeams);
+    }
+    head = 0;
+    count = 0;
+    closing = false;
+    headerPending = false;
+    headerWritten = false;
+    outBuffer.clear();
+    outBuffer.reserve(URG_WRITE_BLOCK_SIZE + 64 * 1024);
+    bufferArrivals.clear();
+    bufferArrivals.reserve(4096);
+    encoder.setup(0);
+    chunkArrivals.clear();
+    chunkArrivals.reserve(URG_CHUNK_SCANS);
+
+    queueDepth = 0;
+    maxQueueDepth = 0;
+    droppedScans = 0;
+    writtenScans = 0;
+    failed = false;
+
+    opened = true;
+    startThread();
+    return true;
+}
+
+// ---------------------------------------------------------------------
+
+void urgRecordWriter::close() {
+
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        if (!opened) return;
+        closing = true;
+    }
+    notEmpty.notify_all();
+    notFull.notify_all();
+
+    // the thread drains the queue before exiting
+    waitForThread(false);
+
+    closeFile();
+    opened = false;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgRecordWriter::openFile() {
+
+    fileBytes = 0;
+    reservedBytes = 0;
+    string name = (sessionId != 0) ? urgSegmentFileName(fileName, segment) : fileName;
+    file.open(name, ofFile::WriteOnly, format != URG_FORMAT_CSV);
+    if (!file.is_open()) {
+        ofLogError("urgRecordWriter") << "could not open " << name;
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------
+
+void urgRecordWriter::closeFile() {
+
+    string path = file.getAbsolutePath();
+    file.close();
+    if (reservedBytes > fileBytes) urgTrim(path, fileBytes);
+}
+
+// ---------------------------------------------------------------------
+
+bool urgRecordWriter::isOpen() {
+    return opened;
+}
+
+bool urgRecordWriter::hasFailed() {
+    return failed;
+}
+
+int urgRecordWriter::getSegment() {
+    return segment;
+}
+
+// ---------------------------------------------------------------------
+
+void urgRecordWriter::setHeader(const urgRecordingHeader& header_, const float* beamAngles) {
+
+    std::unique_lock<std::mutex> lock(queueMutex);
+    header = header_;
+    if (urgHasAngleTable(header.layout)) {
+        headerAngles.assign(header.beamCount, 0);
+        if (beamAngles != NULL) copy(beamAngles, beamAngles + header.beamCount, headerAngles.begin());
+    }
+    else headerAngles.clear();
+    headerPending = true;
+}
+
+// ---------------------------------------------------------------------
+
+bool urgRecordWriter::push(unsigned long time, const float* xy, int nBeams, uint64_t arrival, const int32_t* ranges) {
+
+    std::unique_lock<std::mutex> lock(queueMutex);
+    if (!opened || closing) return false;
+    if (failed) {
+        droppedScans++;
+        return false;
+    }
+
+    // queue is full
+    if (count == (int)slots.size()) {
+
+        if (policy == URG_QUEUE_BLOCK) {
+            notFull.wait(lock, [this]{ return count < (int)slots.size() || closing; });
+            if (closing) return false;
+        }
+        else if (policy == URG_QUEUE_DROP_OLDEST) {
+            head = (head + 1) % slots.size();
+            count--;
+            droppedScans++;
+        }
+        else {
+            // double the ring, keeping queued scans in order starting at slot 0
+            vector<scanSlot> grown(2 * slots.size());
+            for (int i = 0; i < count; i++) {
+                swap(grown[i], slots[(head + i) % slots.size()]);
+            }
+            for (size_t i = count; i < grown.size(); i++) {
+                grown[i].xy.reserve(2 * slotBeams);
+                if (keepRanges) grown[i].ranges.reserve(slotBeams);
+            }
+            slots.swap(grown);
+            head = 0;
+        }
+    }
+
+    // copy the scan into the next free slot
+    scanSlot& slot = slots[(head + count) % slots.size()];
+    slot.time = time;
+    slot.arrival = arrival;
+    slot.nBeams = nBeams;
+    slot.xy.assign(xy, xy + 2 * nBeams);
+    if (keepRanges) {
+        if (ranges != NULL) slot.ranges.assign(ranges, ranges + nBeams);
+        else {
+            slot.ranges.resize(nBeams);
+            for (int i = 0; i < nBeams; i++) slot.ranges[i] = roundf(sqrtf(xy[2 * i] * xy[2 * i] + xy[2 * i + 1] * xy[2 * i + 1]));
+        }
+    }
+    count++;
+
+    queueDepth = count;
+    if (count > maxQueueDepth) maxQueueDepth = count;
+
+    lock.unlock();
+    notEmpty.notify_one();
+    return true;
+}
+
+// ---------------------------------------------------------------------
+
+int urgRecordWriter::getQueueDepth() {
+    return queueDepth;
+}
+
+int urgRecordWriter::getMaxQueueDepth() {
+    return maxQueueDepth;
+}
+
+int urgRecordWriter::getQueueCapacity() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    return slots.size();
+}
+
+unsigned long urgRecordWriter::getDroppedScans() {
+    return droppedScans;
+}
+
+unsigned long urgRecordWriter::getWrittenScans() {
+    return writtenScans;
+}
+
+// ---------------------------------------------------------------------
+
+void urgRecordWriter::setStatsEnabled(bool enabled) {
+    statsEnabled = enabled;
+}
+
+urgHistogram& urgRecordWriter::getFormatTimes() {
+    return formatTimes;
+}
+
+urgHistogram& urgRecordWriter::getWriteTimes() {
+    return writeTimes;
+}
+
+urgHistogram& urgRecordWriter::getLagTimes() {
+    return lagTimes;
+}
+
+// ---------------------------------------------------------------------
+
+void urgRecordWriter::threadedFunction() {
+
+    // scan being written; swapped with queue slots so no copy or allocation is needed
+    scanSlot current;
+    current.xy.reserve(2 * slotBeams);
+    current.ranges.reserve(slotBeams);
+
+    while (true) {
+
+        bool writeHeader = false;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+
+            // while waiting for more scans, write out data that's waited too long
+            // (so a slow sensor's scans reach the disk without a write apiece)
+            if (count == 0 && !outBuffer.empty()) {
+                uint64_t waited = urgMicros() - bufferedSince;
+                if (waited >= URG_WRITE_MAX_DELAY) {
+                    lock.unlock();
+                    flush(true);
+                    continue;
+                }
+                notEmpty.wait_for(lock, std::chrono::microseconds(URG_WRITE_MAX_DELAY - waited), [this]{ return count > 0 || closing; });
+                if (count == 0 && !closing) continue;
+            }
+            else notEmpty.wait(lock, [this]{ return count > 0 || closing; });
+            if (count == 0) break; // closing and everything is written
+
+            if (headerPending) {
+                writeHeader = true;
+                headerPending = false;
+            }
+
+            // take the oldest scan
+            scanSlot& slot = slots[head];
+            swap(current.xy, slot.xy);
+            swap(current.ranges, slot.ranges);
+            current.time = slot.time;
+            current.arrival = slot.arrival;
+            current.nBeams = slot.nBeams;
+            head = (head + 1) % slots.size();
+            count--;
+            queueDepth = count;
+        }
+        notFull.notify_one();
+
+        if (writeHeader) {
+            appendHeader();
+            headerWritten = true;
+        }
+
+        // a segment that's full ends before this scan
+        if (segmentStarted && segmentFull(current.time)) nextSegment();
+
+        // with no file to write to, the scans still queued are lost too
+        if (failed) {
+            droppedScans++;
+            continue;
+        }
+        if (!segmentStarted) {
+            segmentStarted = true;
+            segmentStartTime = current.time;
+        }
+        if (outBuffer.empty()) bufferedSince = urgMicros();
+        writeScan(current);
+
+        if (outBuffer.size() >= URG_WRITE_BLOCK_SIZE) flush();
+    }
+
+    finishChunk();
+    flush(true);
+}
+
+// ---------------------------------------------------------------------
+
+void urgRecordWriter::appendHeader() {
+
+    header.sessionId = sessionId;
+    header.segment = segment;
+    outBuffer.append((const char*)&header, sizeof(header));
+    outBuffer.append((const char*)headerAngles.data(), sizeof(float) * headerAngles.size());
+    if (format == URG_FORMAT_COMPRESSED) encoder.setup(header.beamCount);
+}
+
+// ---------------------------------------------------------------------
+
+void urgRecordWriter::finishChunk() {
+
+    // the last chunk of a compressed recording (or segment) is usually partial
+    if (format == URG_FORMAT_COMPRESSED && encoder.finish()) {
+        outBuffer.append(encoder.getChunk());
+        for (size_t i = 0; i < chunkArrivals.size(); i++) {
+            bufferedArrival arrival = { chunkArrivals[i], fileBytes + outBuffer.size() };
+            bufferArrivals.push_back(arrival);
+        }
+        chunkArrivals.clear();
+    }
+}
+
+// ---------------------------------------------------------------------
+
+bool urgRecordWriter::segmentFull(unsigned long time) {
+
+    if (sessionId == 0) return false;
+    if (segmentMaxBytes > 0 && fileBytes + outBuffer.size() >= segmentMaxBytes) return true;
+    if (segmentMaxMillis > 0 && time - segmentStartTime >= segmentMaxMillis) return true;
+    return false;
+}
+
+// ---------------------------------------------------------------------
+
+void urgRecordWriter::nextSegment() {
+
+    finishChunk();
+    flush(true);
+    closeFile();
+
+    segment++;
+    segmentStarted = false;
+    if (!openFile()) {
+        failed = true;
+        return;
+    }
+
+    // every segment is a complete recording of its own
+    if (headerWritten) appendHeader();
+}
+
+// ---------------------------------------------------------------------
+
+void urgRecordWriter::writeScan(const scanSlot& scan) {
+
+    bool timed = statsEnabled;
+    uint64_t start = timed ? urgMicros() : 0;
+
+    // compressed scans wait in the chunk being built before they reach outBuffer
+    bool arrived = timed && scan.arrival != 0;
+    if (arrived && format == URG_FORMAT_COMPRESSED) chunkArrivals.push_back(scan.arrival);
+
+    const vector<float>& xy = scan.xy;
+    int nBeams = scan.nBeams;
+    if (format == URG_FORMAT_CSV) {
+        urgAppendCsvScan(outBuffer, scan.time, xy.data(), nBeams);
+    }
+    else if (format == URG_FORMAT_COMPRESSED) {
+        if (encoder.add(scan.time, scan.ranges.data(), nBeams)) {
+            outBuffer.append(encoder.getChunk());
+            for (size_t i = 0; i < chunkArrivals.size(); i++) {
+                bufferedArrival arrival = { chunkArrivals[i], fileBytes + outBuffer.size() };
+                bufferArrivals.push_back(arrival);
+            }
+            chunkArrivals.clear();
+        }
+    }
+    else {
+        // records are fixed size: pad short scans with zeros and drop extra beams
+        uint32_t recordTime = scan.time;
+        outBuffer.append((const char*)&recordTime, sizeof(recordTime));
+
+        int nKept = min(nBeams, (int)header.beamCount);
+        size_t beamSize = (format == URG_FORMAT_POLAR) ? sizeof(int32_t) : 2 * sizeof(float);
+        const char* beams = (format == URG_FORMAT_POLAR) ? (const char*)scan.ranges.data() : (const char*)xy.data();
+        outBuffer.append(beams, beamSize * nKept);
+        if (nKept < (int)header.beamCount) outBuffer.append(beamSize * (header.beamCount - nKept), '\0');
+    }
+    if (arrived && format != URG_FORMAT_COMPRESSED) {
+        bufferedArrival arrival = { scan.arrival, fileBytes + outBuffer.size() };
+        bufferArrivals.push_back(arrival);
+    }
+    writtenScans++;
+
+    if (timed) formatTimes.add(urgMicros() - start);
+}
+
+// ---------------------------------------------------------------------
+
+void urgRecordWriter::flush(bool all) {
+
+    if (failed) {
+        outBuffer.clear();
+        bufferArrivals.clear();
+        return;
+    }
+
+    // whole blocks, ending on a block boundary of the file
+    uint64_t boundary = (fileBytes + outBuffer.size()) / URG_WRITE_BLOCK_SIZE * URG_WRITE_BLOCK_SIZE;
+    size_t n = all ? outBuffer.size() : (boundary > fileBytes) ? boundary - fileBytes : 0;
+    if (n == 0) return;
+
+    uint64_t start = statsEnabled ? urgMicros() : 0;
+
+    // keep disk reserved ahead of the file: all of a segment of bounded size at
+    // once, and always at least the block being written
+    uint64_t needed = fileBytes + outBuffer.size() + URG_WRITE_BLOCK_SIZE;
+    if (needed > reservedBytes) {
+        uint64_t reserve = (sessionId != 0 && segmentMaxBytes > 0) ? max(segmentMaxBytes, fileBytes) + URG_WRITE_BLOCK_SIZE : fileBytes + URG_RESERVE_STEP;
+        reserve = max(reserve, needed);
+        // (a reservation that didn't happen is tried again on the next write)
+        if (urgReserve(file.getAbsolutePath(), reservedBytes, reserve - reservedBytes)) reservedBytes = reserve;
+        else ofLogVerbose("urgRecordWriter") << "could not reserve disk for " << file.getAbsolutePath();
+    }
+
+    file.write(outBuffer.data(), n);
+    file.flush();
+    fileBytes += n;
+    outBuffer.erase(0, n);
+    bufferedSince = urgMicros();
+
+    // the scans whose data is all in the file are now on disk
+    size_t nWritten = 0;
+    while (nWritten < bufferArrivals.size() && bufferArrivals[nWritten].end <= fileBytes) nWritten++;
+    if (start != 0) {
+        uint64_t now = urgMicros();
+        writeTimes.add(now - start);
+        for (size_t i = 0; i < nWritten; i++) lagTimes.add(now - bufferArrivals[i].arrival);
+    }
+    bufferArrivals.erase(bufferArrivals.begin(), bufferArrivals.begin() + nWritten);
+}
@@ -0,0 +1,187 @@
+//
+//  urgRecordWriter.h
+//  urg_record
+//
+//  Writes scans to a recording file on a background thread, so a slow
+//  disk never stalls the main thread that drains OSC messages.
+//  Scans are handed over through a bounded queue of preallocated buffers.
+//  Compressed recordings are encoded a chunk at a time on the same thread,
+//  so up to a chunk of scans is only on disk once it's complete.
+//  Disk space is reserved ahead of what's written, and long recordings can
+//  be split into segments of bounded size or duration (see urgFormat.h).
+//
+
+#ifndef __urg_record__urgRecordWriter__
+#define __urg_record__urgRecordWriter__
+
+#include "ofMain.h"
+#include "urgFormat.h"
+#include "urgCodec.h"
+#include "urgStats.h"
+
+// what push() does when the queue is full
+enum urgQueuePolicy {
+    URG_QUEUE_BLOCK = 0,        // wait for the writer to free a slot
+    URG_QUEUE_DROP_OLDEST = 1,  // discard the oldest queued scan
+    URG_QUEUE_GROW = 2          // allocate more slots
+};
+
+class urgRecordWriter : public ofThread {
+
+public:
+
+    urgRecordWriter();
+    ~urgRecordWriter();
+
+    // number of preallocated scan slots and the policy when they're all in use
+    // (takes effect on the next open)
+    void setup(int capacity = 256, urgQueuePolicy policy = URG_QUEUE_DROP_OLDEST, int nBeams = 682);
+
+    // split recordings into segments once they reach maxBytes or hold maxMillis
+    // of scans (0 for no limit; both 0 to write a single file); takes effect
+    // on the next open
+    void setSegments(uint64_t maxBytes, unsigned long maxMillis);
+
+    // open a new recording file and start the writer thread; the file is the
+    // first segment of session sessionId (a new id if 0) if segments are set
+    bool open(string fileName, urgRecordingFormat format, uint64_t sessionId = 0);
+
+    // write out every queued scan, then close the file and stop the thread
+    void close();
+
+    bool isOpen();
+
+    // a segment's file could not be opened, so every later scan is dropped
+    bool hasFailed();
+
+    // segment being written (0 for recordings that aren't segmented)
+    int getSegment();
+
+    // header to write before the first record of a binary recording, and
+    // the angle of each beam for layouts that have an angle table
+    void setHeader(const urgRecordingHeader& header, const float* beamAngles = NULL);
+
+    // queue one scan of interleaved x/y (mm) taken at time (ms) and received
+    // at arrival (urgMicros(), for the lag stats); returns false if the scan was not queued
+    // compressed and polar recordings store the ranges (mm), which are worked
+    // out from x/y when they aren't given
+    bool push(unsigned long time, const float* xy, int nBeams, uint64_t arrival = 0, const int32_t* ranges = NULL);
+
+    // counters
+    int getQueueDepth();
+    int getMaxQueueDepth();
+    int getQueueCapacity();
+    unsigned long getDroppedScans();
+    unsigned long getWrittenScans();
+
+    // time the writer thread's stages (off by default)
+    void setStatsEnabled(bool enabled);
+
+    // microseconds to format a scan, to write a block to disk, and from a
+    // scan's arrival until it's on disk
+    urgHistogram& getFormatTimes();
+    urgHistogram& getWriteTimes();
+    urgHistogram& getLagTimes();
+
+private:
+
+    void threadedFunction();
+
+    // write outBuffer to file: as much of it as ends on a block boundary in
+    // the file, or all of it (at the end of a file, or once it's waited too long)
+    void flush(bool all = false);
+
+    // open the file for the current segment, and close it
+    bool openFile();
+    void closeFile();
+
+    // finish the current segment and go on to the next
+    void nextSegment();
+
+    // add the header (and beam angles) to outBuffer
+    void appendHeader();
+
+    // add the chunk being built to outBuffer, for the end of a compressed file
+    void finishChunk();
+
+    // whether the next scan (taken at time) belongs in a new segment
+    bool segmentFull(unsigned long time);
+
+    struct scanSlot {
+        unsigned long time;
+        uint64_t arrival;
+        int nBeams;
+        vector<float> xy;
+        vector<int32_t> ranges;
+    };
+
+    // format one scan into outBuffer
+    void writeScan(const scanSlot& scan);
+
+    // ring of slots: count queued scans starting at head
+    vector<scanSlot> slots;
+    int head = 0;
+    int count = 0;
+
+    int capacity = 256;
+    urgQueuePolicy policy = URG_QUEUE_DROP_OLDEST;
+    int slotBeams = 682;
+
+    std::mutex queueMutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    bool closing = false;
+
+    ofFile file;
+    string fileName;
+    urgRecordingFormat format = URG_FORMAT_CSV;
+    bool keepRanges = false;    // the format stores ranges rather than x/y
+    bool opened = false;
+    urgRecordingHeader header;
+    vector<float> headerAngles;
+    bool headerPending = false;
+    bool headerWritten = false;
+
+    // segments: limits, the session, and the segment being written
+    uint64_t segmentMaxBytes = 0;
+    unsigned long segmentMaxMillis = 0;
+    uint64_t sessionId = 0;
+    std::atomic<int> segment;
+    bool segmentStarted = false;        // the segment holds a scan
+    unsigned long segmentStartTime = 0; // time of its first scan
+
+    // bytes written to the file, and bytes of disk reserved for it
+    uint64_t fileBytes = 0;
+    uint64_t reservedBytes = 0;
+
+    // compressed recordings: the chunk being built and the arrival times of its scans
+    urgChunkEncoder encoder;
+    vector<uint64_t> chunkArrivals;
+
+    // formatted data waiting to be written to file
+    string outBuffer;
+
+    std::atomic<int> queueDepth;
+    std::atomic<int> maxQueueDepth;
+    std::atomic<unsigned long> droppedScans;
+    std::atomic<bool> failed;
+    std::atomic<unsigned long> writtenScans;
+
+    std::atomic<bool> statsEnabled;
+    urgHistogram formatTimes;
+    urgHistogram writeTimes;
+    urgHistogram lagTimes;
+
+    // when the oldest data in outBuffer was formatted (urgMicros())
+    uint64_t bufferedSince = 0;
+
+    // arrival times of the scans in outBuffer, and the file offset each one's data ends at
+    struct bufferedArrival {
+        uint64_t arrival;
+        uint64_t end;
+    };
+    vector<bufferedArrival> bufferArrivals;
+
+};
+
+#endif /* defined(__urg_record__urgRecordWriter__) */
@@ -32,6 +32,47 @@ urgRecorder::urgRecorder() {
     recordingParams.add(stopRecording.set("Stop Recording", false));
     recordingParams.add(recordingState.set("Recording State", false));
     recordingParams.add(liveData.set("Live Data", false));
+    recordingParams.add(binaryFormat.set("Binary Format", false));
+    recordingParams.add(compressedFormat.set("Compressed Format", false));
+    recordingParams.add(polarFormat.set("Polar Format", false));
+    recordingParams.add(writerQueueSize.set("Writer Queue Size", 256, 16, 4096));
+    recordingParams.add(writerQueuePolicy.set("Writer Queue Policy", URG_QUEUE_DROP_OLDEST, URG_QUEUE_BLOCK, URG_QUEUE_GROW));
+    recordingParams.add(writerQueueDepth.set("Writer Queue Depth", 0, 0, 4096));
+    recordingParams.add(droppedScans.set("Dropped Scans", 0, 0, numeric_limits<int>::max()));
+    recordingParams.add(segmentMB.set("Segment MB", 0, 0, 65536));
+    recordingParams.add(segmentMinutes.set("Segment Minutes", 0, 0, 1440));
+    recordingParams.add(currentSegment.set("Current Segment", 0, 0, 100000));
+    recordingParams.add(statsEnabled.set("Enable Stats", false));
+    recordingParams.add(statsInterval.set("Stats Interval", 5, 1, 60));
+    recordingParams.add(statsOscPort.set("Stats OSC Port", 0, 0, 65535));
+    recordingParams.add(sensorPorts.set("Sensor Ports", "7777"));
+    recordingParams.add(renderSensor.set("Render Sensor", 0, 0, 7));
+    recordingParams.add(backgroundSubtraction.set("Background Subtraction", false));
+    recordingParams.add(resetBackground.set("Reset Background", false));
+    recordingParams.add(backgroundStep.set("Background Step", 5, 0.1, 100));
+    recordingParams.add(foregroundDistance.set("Foreground Distance", 100, 10, 2000));
+    recordingParams.add(foregroundDeviations.set("Foreground Deviations", 4, 0, 20));
+    recordingParams.add(recordForegroundOnly.set("Record Foreground Only", false));
+    recordingParams.add(foregroundOscPort.set("Foreground OSC Port", 0, 0, 65535));
+    recordingParams.add(foregroundBeams.set("Foreground Beams", 0, 0, 4096));
+    recordingParams.add(blobTracking.set("Blob Tracking", false));
+    recordingParams.add(blobDistance.set("Blob Distance", 150, 10, 1000));
+    recordingParams.add(minBlobBeams.set("Min Blob Beams", 3, 1, 100));
+    recordingParams.add(trackMatchDistance.set("Track Match Distance", 500, 50, 3000));
+    recordingParams.add(trackerOscPort.set("Tracker OSC Port", 0, 0, 65535));
+    recordingParams.add(trackedBlobs.set("Tracked Blobs", 0, 0, 128));
+    
+}
+
+//--------------------------------------------------------------
+
+void urgRecorder::setup() {
+    
+    vector<int> ports;
+    vector<string> items = ofSplitString(sensorPorts, ",", true, true);
+    for (size_t i = 0; i < items.size(); i++) ports.push_back(ofToInt(items[i]));
+    if (ports.empty()) ports.push_back(7777);
+    setup(ports);
     
 }
 
@@ -39,10 +80,28 @@ urgRecorder::urgRecorder() {
 
 void urgRecorder::setup(int port) {
     
-    oscPort = port;
+    setup(vector<int>(1, port));
     
-    // connect to osc
-    receiver.setup(oscPort);
+}
+
+//--------------------------------------------------------------
+
+void urgRecorder::setup(const vector<int>& ports) {
+    
+    // connect to osc, each port on its own receive thread
+    sensors.clear();
+    for (size_t i = 0; i < ports.size(); i++) {
+        shared_ptr<sensorStream> sensor(new sensorStream);
+        sensor->port = ports[i];
+        sensor->receiver.setup(ports[i]);
+        sensor->tracker.setup(i, ports.size());
+        sensors.push_back(sensor);
+    }
+    renderSensor.setMax(max((int)sensors.size() - 1, 0));
+    
+    // allocate the realtime render's history
+    // (its slots are sized by the first scan, whatever the sensor's beam count)
+    history.setup(nMeshes.getMax());
     
 }
 
@@ -55,18 +114,34 @@ void urgRecorder::update() {
     if (startRecording) {
         startRecording = false;
         
-        // create a timestamped title and a new file
-        string fileName = ofGetTimestampString() + "_recording" + ".csv";
-        recFile.open(ofToDataPath(fileName), ofFile::WriteOnly);
+        // create a timestamped title and a new file for each sensor
+        recordingFormat = compressedFormat ? URG_FORMAT_COMPRESSED : polarFormat ? URG_FORMAT_POLAR : binaryFormat ? URG_FORMAT_BINARY : URG_FORMAT_CSV;
+        // long recordings are split into segments (one session shared by every sensor)
+        string timestamp = ofGetTimestampString();
+        uint64_t sessionId = urgMakeSessionId();
+        bool opened = true;
+        for (size_t i = 0; i < sensors.size() && opened; i++) {
+            sensorStream& sensor = *sensors[i];
+            string fileName = timestamp + "_recording" + (sensors.size() > 1 ? "_" + ofToString(sensor.port) : "") + (recordingFormat != URG_FORMAT_CSV ? "." URG_BINARY_EXTENSION : ".csv");
+            sensor.writer.setup(writerQueueSize, (urgQueuePolicy)writerQueuePolicy.get());
+            sensor.writer.setSegments((uint64_t)segmentMB * 1024 * 1024, (unsigned long)segmentMinutes * 60 * 1000);
+            opened = sensor.writer.open(ofToDataPath(fileName), recordingFormat, sessionId);
+            sensor.binaryHeaderWritten = false;
+        }
         
-        // set recordingState to true
-        recordingState = true;
+        // set recordingState to true (unless a file couldn't be opened, when
+        // nothing is recorded rather than only some of the sensors)
+        if (!opened) {
+            ofLogError("urgRecorder") << "could not open a recording file for every sensor; not recording";
+            for (size_t i = 0; i < sensors.size(); i++) sensors[i]->writer.close();
+        }
+        recordingState = opened;
         
         // reset the counter of the number of scans received
         scanCounter = 0;
         
-        // clear meshes for realtime render
-        scans.clear();
+        // clear scans for realtime render
+        history.clear();
     }
     
     
@@ -75,8 +150,8 @@ void urgRecorder::update() {
     if (stopRecording) {
         stopRecording = false;
         
-        // close file
-        recFile.close();
+        // write out everything still queued and close the files
+        for (size_t i = 0; i < sensors.size(); i++) sensors[i]->writer.close();
         
         recordingState = false;
     }
@@ -84,96 +159,336 @@ void urgRecorder::update() {
     // set flip direction for spherical capture
     flipDirection = (mirror) ? -1 : 1;
     
-    // get the data if there are waiting messages
-    while(receiver.hasWaitingMessages()){
+    if (!backgroundSubtraction) foregroundBeams = 0;
+    if (!blobTracking) {
+        trackedBlobs = 0;
+        points.clear();
+    }
+    
+    // learn every sensor's background again
+    if (resetBackground) {
+        resetBackground = false;
+        for (size_t i = 0; i < sensors.size(); i++) sensors[i]->background.clear();
+    }
+    
+    // (re)connect the foreground and tracker senders when their ports change
+    if (foregroundOscPort != foregroundSenderPort) {
+        foregroundSenderPort = foregroundOscPort;
+        if (foregroundSenderPort > 0) foregroundSender.setup("localhost", foregroundSenderPort);
+    }
+    if (trackerOscPort != trackerSenderPort) {
+        trackerSenderPort = trackerOscPort;
+        if (trackerSenderPort > 0) trackerSender.setup("localhost", trackerSenderPort);
+    }
+    
+    // stats cost a flag check per stage when they're off
+    bool timed = statsEnabled;
+    int nDrained = 0;
+    
+    // a recording's times count from the first scan to arrive from any sensor
+    if (scanCounter == 0) {
+        bool waiting = false;
+        for (size_t i = 0; i < sensors.size(); i++) {
+            urgReceivedScan* received = sensors[i]->receiver.front();
+            if (received == NULL) continue;
+            if (!waiting || received->arrival < timeZero) timeZero = received->arrival;
+            waiting = true;
+        }
         
-        // get the next message
-        ofxOscMessage m;
-        receiver.getNextMessage(m);
+        // the same moment on the wall clock, for every sensor's header
+        if (waiting) timeZeroUnixMillis = urgUnixTimeMillis() - (urgMicros() - timeZero) / 1000;
+    }
+    
+    // take the scans each sensor's receive thread has queued
+    for (size_t i = 0; i < sensors.size(); i++) {
+        sensorStream& sensor = *sensors[i];
+        sensor.writer.setStatsEnabled(timed);
+        while (sensor.receiver.front() != NULL) {
+            addScan(sensor, (int)i == renderSensor, timed);
+            nDrained++;
+        }
+    }
+    
+    // we're getting data if any sensor is
+    liveData = false;
+    for (size_t i = 0; i < sensors.size(); i++) {
+        if (sensors[i]->live) liveData = true;
+    }
+    
+    if (ofGetElapsedTimeMillis() - lastDataTime > dataTimeout) liveData = false;
+    
+    // show how the writer threads are keeping up
+    int queueDepth = 0, segment = 0;
+    unsigned long nDropped = 0;
+    for (size_t i = 0; i < sensors.size(); i++) {
+        queueDepth += sensors[i]->writer.getQueueDepth();
+        nDropped += sensors[i]->writer.getDroppedScans();
+        segment = max(segment, sensors[i]->writer.getSegment());
+    }
+    writerQueueDepth = queueDepth;
+    droppedScans = nDropped;
+    currentSegment = segment;
+    
+    if (timed) {
+        drainedMessages.add(nDrained);
+        if (urgMicros() - lastStatsReport >= statsInterval * 1000000) reportStats();
+    }
+    
+}
+
+//--------------------------------------------------------------
+
+void urgRecorder::addScan(sensorStream& sensor, bool render, bool timed) {
+    
+    urgReceivedScan* received = sensor.receiver.front();
+    uint64_t arrival = received->arrival;
+    uint64_t convertStart = timed ? urgMicros() : 0;
+    if (timed) queueTimes.add(convertStart - arrival);
+    
+    // mark that we're getting data
+    lastDataTime = ofGetElapsedTimeMillis();
+    
+    // find the current time from when the scan arrived
+    unsigned long thisTime = (arrival - timeZero) / 1000;
+    
+    // ---------- GET AND STORE THE DATA ---------
+    
+    long sum = 0;
+    // copy the scan out (into buffers that keep their memory between scans),
+    // so the slot goes back to the receive thread with its own preallocated
+    // buffers, and it never allocates
+    int nBeams = received->ranges.size();
+    scanRanges.assign(received->ranges.begin(), received->ranges.end());
+    scanAngles.assign(received->angles.begin(), received->angles.end());
+    sensor.receiver.pop();
+    scanPoints.resize(2 * nBeams);
+    
+    // check if we're receiving data by summing all of it
+    for(int i = 0; i < nBeams; i++) sum += scanRanges[i];
+    
+    // convert to cartesian coordinates for the recording and the realtime render
+    sensor.beamTable.convert(scanRanges.data(), scanAngles.data(), nBeams, scanPoints.data());
+    
+    if (timed) {
+        convertTimes.add(urgMicros() - convertStart);
         
-        // check for point dataa
-        if(m.getAddress() == "/urg/raw/data"){
-            
-            // mark that we're getting data
-            lastDataTime = ofGetElapsedTimeMillis();
-            
-            // reset the last scan
-            lastScan.clear();
-            
-            // find the current time
-            unsigned long thisTime;
-            if (scanCounter == 0) {
-                // if this is the first scan we're recording, set timeZero
-                timeZero = ofGetElapsedTimeMillis();
-                thisTime = 0;
-            } else {
-                thisTime = ofGetElapsedTimeMillis() - timeZero;
-            }
-            
-            // ---------- GET AND STORE THE DATA ---------
-            
-            // if we're recording data, write time to file
-            if (recordingState) {
-                recFile << ofToString(thisTime) << ",";
-            }
-            
-            long sum = 0;
-            
-            // write arguments of message to file
-            for(int i = 0; i < m.getNumArgs(); i+=2){
-                float r = m.getArgAsInt32(i);
-                float theta = m.getArgAsFloat(i+1);
-                
-                float x = r * cos(theta); // convert to cartesian coordinates
-                float y = r * sin(theta);
-                
-                // if we're recording data, write points to file
-                if (recordingState) {
-                    if (i != 0) recFile << ",";
-                    recFile << ofToString(x) + "," + ofToString(y);
-                }
-                
-                // check if we're receiving data by summing all of it
-                sum += r;
-                
-                // add point to mesh in XY plane
-                lastScan.addVertex(ofVec3f(x, y, 0.));
-            }
-            
-            liveData = (sum == 0) ? false : true;
-            
-            // add this mesh to the last scans
-            scans.insert(scans.begin(), lastScan);
-            while(scans.size() > nMeshes) { // resize to nMeshes
-                scans.pop_back();
-            }
-            
-            // increment scan counter
-            scanCounter++;
-            
-            // if we're recording data, add a line break
-            if (recordingState) {
-                recFile << "\n";
-            }
+        // the sensor sometimes sends a scan twice
+        sensor.receivedScans++;
+        if ((int)sensor.lastRanges.size() == nBeams && nBeams > 0 && memcmp(sensor.lastRanges.data(), scanRanges.data(), nBeams * sizeof(int32_t)) == 0) sensor.duplicatedScans++;
+        sensor.lastRanges.assign(scanRanges.begin(), scanRanges.end());
+    }
+    
+    sensor.live = (sum != 0);
+    
+    if (backgroundSubtraction && nBeams > 0) subtractBackground(sensor, thisTime, render, timed);
+    if (blobTracking && nBeams > 0) trackBlobs(sensor, thisTime, render, timed);
+    
+    // if we're recording data, hand the scan to the sensor's writer thread
+    if (recordingState && nBeams > 0) {
+        
+        // the first scan of a binary recording fixes its beam count and angles
+        if (recordingFormat != URG_FORMAT_CSV && !sensor.binaryHeaderWritten) {
+            float startAngle = scanAngles[0];
+            float angularResolution = (nBeams > 1) ? (scanAngles[nBeams - 1] - startAngle) / (nBeams - 1) : 0;
+            uint32_t layout = (recordingFormat == URG_FORMAT_COMPRESSED) ? URG_LAYOUT_DELTA_RANGES : (recordingFormat == URG_FORMAT_POLAR) ? URG_LAYOUT_POLAR : URG_LAYOUT_CARTESIAN;
+            sensor.writer.setHeader(urgMakeHeader(nBeams, angularResolution, startAngle, sensor.port, timeZeroUnixMillis, layout), scanAngles.data());
+            sensor.binaryHeaderWritten = true;
         }
         
-        // check for tracker data
-//        if(m.getAddress() == "/urg/tracker/data"){
-//            for(int i = 0; i < m.getNumArgs(); i+=3){
-//                points[m.getArgAsInt32(i)] = ofVec2f(m.getArgAsInt32(i+1), m.getArgAsInt32(i+2));
-//            }
-//        }
-        
-        // if we're rendering, increment thisAngle
-        if (drawRender) {
-//            cout << "here:\t" << (float)flipDirection * rotationStep / (float)stepResolution << endl;
-            rotation += (float)flipDirection * rotationStep / (float)stepResolution;
-            if (rotation > 360.) rotation = fmod(rotation, 360.f);
+        sensor.writer.push(thisTime, scanPoints.data(), nBeams, arrival, scanRanges.data());
+    }
+    
+    // increment scan counter
+    scanCounter++;
+    
+    // only one sensor is shown in the realtime render
+    if (!render) return;
+    
+    // add this scan to the last scans
+    uint64_t renderStart = timed ? urgMicros() : 0;
+    history.push(thisTime, scanPoints.data(), nBeams);
+    if (timed) renderTimes.add(urgMicros() - renderStart);
+    
+    // if we're rendering, increment thisAngle
+    if (drawRender) {
+//        cout << "here:\t" << (float)flipDirection * rotationStep / (float)stepResolution << endl;
+        rotation += (float)flipDirection * rotationStep / (float)stepResolution;
+        if (rotation > 360.) rotation = fmod(rotation, 360.f);
+    }
+    
+}
+
+//--------------------------------------------------------------
+
+void urgRecorder::subtractBackground(sensorStream& sensor, unsigned long time, bool render, bool timed) {
+    
+    uint64_t start = timed ? urgMicros() : 0;
+    int nBeams = scanRanges.size();
+    
+    sensor.background.setup(backgroundStep, foregroundDistance, foregroundDeviations);
+    sensor.foreground.resize(nBeams);
+    const uint8_t* foreground = sensor.foreground.data();
+    int nForeground = sensor.background.apply(scanRanges.data(), nBeams, sensor.foreground.data());
+    sensor.modelledBeams += nBeams;
+    sensor.foregroundBeams += nForeground;
+    if (render) foregroundBeams = nForeground;
+    
+    // publish the foreground beams (an empty scan too, so listeners see it's clear)
+    if (foregroundSenderPort > 0) {
+        ofxOscMessage m;
+        m.setAddress("/urg/foreground");
+        m.addIntArg(sensor.port);
+        m.addIntArg(time);
+        for (int i = 0; i < nBeams; i++) {
+            if (!foreground[i]) continue;
+            m.addIntArg(i);
+            m.addIntArg(scanRanges[i]);
         }
+        foregroundSender.sendMessage(m, false);
     }
     
-    if (ofGetElapsedTimeMillis() - lastDataTime > dataTimeout) liveData = false;
+    // the background is recorded (and rendered) as no return
+    if (recordForegroundOnly) {
+        for (int i = 0; i < nBeams; i++) {
+            scanRanges[i] *= foreground[i];
+            scanPoints[2 * i] *= foreground[i];
+            scanPoints[2 * i + 1] *= foreground[i];
+        }
+    }
+    
+    if (timed) backgroundTimes.add(urgMicros() - start);
+}
+
+//--------------------------------------------------------------
+
+void urgRecorder::trackBlobs(sensorStream& sensor, unsigned long time, bool render, bool timed) {
     
+    uint64_t start = timed ? urgMicros() : 0;
+    int nBeams = scanRanges.size();
+    
+    urgBlobTracker& tracker = sensor.tracker;
+    tracker.blobDistance = blobDistance;
+    tracker.minBlobBeams = minBlobBeams;
+    tracker.matchDistance = trackMatchDistance;
+    const uint8_t* mask = (backgroundSubtraction && (int)sensor.foreground.size() == nBeams) ? sensor.foreground.data() : NULL;
+    int nReported = tracker.update(time, scanRanges.data(), scanPoints.data(), nBeams, mask);
+    
+    // publish the tracks (none too, so listeners see they've gone)
+    const vector<urgTrack>& tracks = tracker.getTracks();
+    if (trackerSenderPort > 0) {
+        ofxOscMessage m;
+        m.setAddress("/urg/tracker/data");
+        for (size_t t = 0; t < tracks.size(); t++) {
+            if (!tracker.isReported(tracks[t])) continue;
+            m.addIntArg(tracks[t].id);
+            m.addIntArg(tracks[t].position.x);
+            m.addIntArg(tracks[t].position.y);
+        }
+        trackerSender.sendMessage(m, false);
+    }
+    
+    if (render) {
+        trackedBlobs = nReported;
+        points.clear();
+        for (size_t t = 0; t < tracks.size(); t++) {
+            if (tracker.isReported(tracks[t])) points[tracks[t].id] = tracks[t].position;
+        }
+    }
+    
+    if (timed) trackerTimes.add(urgMicros() - start);
+}
+
+//--------------------------------------------------------------
+
+void urgRecorder::reportStats() {
+    
+    // (re)connect the stats sender when its port changes
+    if (statsOscPort != statsSenderPort) {
+        statsSenderPort = statsOscPort;
+        if (statsSenderPort > 0) statsSender.setup("localhost", statsSenderPort);
+    }
+    
+    // the writers' histograms are moved into the recorder's, so they're
+    // reported over all the sensors at once
+    unsigned long received = 0, duplicated = 0, dropped = 0, written = 0, receiveDropped = 0;
+    int queueDepth = 0, maxQueueDepth = 0, receiveQueueDepth = 0;
+    string sensorText;
+    ofxOscBundle bundle;
+    for (size_t i = 0; i < sensors.size(); i++) {
+        sensorStream& sensor = *sensors[i];
+        
+        formatTimes.take(sensor.writer.getFormatTimes());
+        writeTimes.take(sensor.writer.getWriteTimes());
+        lagTimes.take(sensor.writer.getLagTimes());
+        
+        received += sensor.receivedScans;
+        duplicated += sensor.duplicatedScans;
+        dropped += sensor.writer.getDroppedScans();
+        written += sensor.writer.getWrittenScans();
+        receiveDropped += sensor.receiver.getDroppedScans();
+        queueDepth += sensor.writer.getQueueDepth();
+        maxQueueDepth = max(maxQueueDepth, (int)sensor.writer.getMaxQueueDepth());
+        receiveQueueDepth += sensor.receiver.getQueueDepth();
+        
+        // per sensor counters
+        sensorText += "sensor port=" + ofToString(sensor.port) + " received=" + ofToString(sensor.receivedScans) + " duplicated=" + ofToString(sensor.duplicatedScans) + " receive_dropped=" + ofToString(sensor.receiver.getDroppedScans()) + " written=" + ofToString(sensor.writer.getWrittenScans()) + " dropped=" + ofToString(sensor.writer.getDroppedScans()) + " modelled_beams=" + ofToString(sensor.modelledBeams) + " foreground_beams=" + ofToString(sensor.foregroundBeams) + "\n";
+        ofxOscMessage m;
+        m.setAddress("/urg/stats/sensor");
+        m.addIntArg(sensor.port);
+        m.addInt64Arg(sensor.receivedScans);
+        m.addInt64Arg(sensor.duplicatedScans);
+        m.addInt64Arg(sensor.receiver.getDroppedScans());
+        m.addInt64Arg(sensor.writer.getWrittenScans());
+        m.addInt64Arg(sensor.writer.getDroppedScans());
+        m.addInt64Arg(sensor.modelledBeams);
+        m.addInt64Arg(sensor.foregroundBeams);
+        bundle.addMessage(m);
+    }
+    
+    string names[] = { "drained_per_frame", "receive_queue_us", "convert_us", "render_us", "background_us", "tracker_us", "format_us", "write_us", "lag_us" };
+    urgHistogram* histograms[] = { &drainedMessages, &queueTimes, &convertTimes, &renderTimes, &backgroundTimes, &trackerTimes, &formatTimes, &writeTimes, &lagTimes };
+    
+    string text;
+    
+    // counters (since setup or the start of the recording), summed over the sensors
+    text += "counters received=" + ofToString(received) + " duplicated=" + ofToString(duplicated) + " dropped=" + ofToString(dropped) + " written=" + ofToString(written) + " queue_depth=" + ofToString(queueDepth) + " max_queue_depth=" + ofToString(maxQueueDepth) + " receive_dropped=" + ofToString(receiveDropped) + " receive_queue_depth=" + ofToString(receiveQueueDepth) + "\n";
+    text += sensorText;
+    ofxOscMessage counters;
+    counters.setAddress("/urg/stats/counters");
+    counters.addInt64Arg(received);
+    counters.addInt64Arg(duplicated);
+    counters.addInt64Arg(dropped);
+    counters.addInt64Arg(written);
+    counters.addIntArg(queueDepth);
+    counters.addIntArg(maxQueueDepth);
+    counters.addInt64Arg(receiveDropped);
+    counters.addIntArg(receiveQueueDepth);
+    bundle.addMessage(counters);
+    
+    // histograms (over the last interval)
+    for (int i = 0; i < 9; i++) {
+        urgHistogram& h = *histograms[i];
+        uint64_t p50 = h.getPercentile(50);
+        uint64_t p99 = h.getPercentile(99);
+        text += names[i] + " count=" + ofToString(h.getCount()) + " p50=" + ofToString(p50) + " p99=" + ofToString(p99) + " max=" + ofToString(h.getMax()) + " mean=" + ofToString(h.getMean()) + "\n";
+        
+        ofxOscMessage m;
+        m.setAddress("/urg/stats/" + names[i]);
+        m.addInt64Arg(h.getCount());
+        m.addInt64Arg(p50);
+        m.addInt64Arg(p99);
+        m.addInt64Arg(h.getMax());
+        m.addFloatArg(h.getMean());
+        bundle.addMessage(m);
+        
+        h.reset();
+    }
+    
+    ofBuffer buffer(text.data(), text.size());
+    ofBufferToFile(statsFileName, buffer);
+    if (statsSenderPort > 0) statsSender.sendBundle(bundle);
+    
+    lastStatsReport = urgMicros();
 }
 
 //--------------------------------------------------------------
@@ -191,21 +506,33 @@ void urgRecorder::draw() {
         if (!spherical) {
             
             // draw each mesh to screen, increasingly further back
-            for (int i = 0; i < scans.size(); i++) {
+            for (int i = 0; i < min(history.size(), nMeshes.get()); i++) {
                 
                 ofPushMatrix();
                 ofTranslate(0., 0., - i * zSpacing / 2);
                 ofRotateZ(zRotation);
                 if (mirror) ofRotateY(180);
-                scans[i].drawVertices();
+                history.drawScan(i);
                 ofPopMatrix();
             }
+            
+            // tracked blobs, on the newest scan
+            ofPushMatrix();
+            ofRotateZ(zRotation);
+            if (mirror) ofRotateY(180);
+            ofNoFill();
+            for (map<int, ofVec2f>::iterator it = points.begin(); it != points.end(); ++it) {
+                ofDrawCircle(it->second.x, it->second.y, 250);
+                ofDrawBitmapString(ofToString(it->first), it->second.x, it->second.y);
+            }
+            ofFill();
+            ofPopMatrix();
         }
         
         // otherwise, draw data as spherical
         else {
             
-            for (int i = 0; i < scans.size(); i++) {
+            for (int i = 0; i < min(history.size(), nMeshes.get()); i++) {
                 
                 ofPushMatrix();
                 ofRotateZ(-90.);
@@ -214,7 +541,7 @@ void urgRecorder::draw() {
                 // rotate to thisAngle + the step of this scan
                 ofRotateX(rotation - (float)flipDirection * 2 * i * rotationStep / (float)stepResolution);
                 
-                scans[i].drawVertices();
+                history.drawScan(i);
                 ofPopMatrix();
             }
         }
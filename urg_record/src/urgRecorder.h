@@ -17,6 +17,14 @@
 #include "ofMain.h"
 #include "ofxGui.h"
 #include "ofxOsc.h"
+#include "urgFormat.h"
+#include "urgRecordWriter.h"
+#include "urgScanHistory.h"
+#include "urgBeamTable.h"
+#include "urgStats.h"
+#include "urgScanReceiver.h"
+#include "urgBackgroundModel.h"
+#include "urgBlobTracker.h"
 
 class urgRecorder {
     
@@ -41,17 +49,80 @@ public:
     ofParameter<bool> stopRecording;    // flag to stop recording
     ofParameter<bool> recordingState;
     ofParameter<bool> liveData;         // whether we're currently getting data
+    ofParameter<bool> binaryFormat;     // record to the compact binary format instead of CSV
+    ofParameter<bool> compressedFormat; // record to the compressed binary format (smaller still)
+    ofParameter<bool> polarFormat;      // record the ranges the sensor sends, unconverted
+    ofParameter<int> writerQueueSize;   // scans buffered for the writer thread
+    ofParameter<int> writerQueuePolicy; // when the queue is full: 0 = block, 1 = drop oldest, 2 = grow
+    ofParameter<int> writerQueueDepth;  // scans currently waiting to be written
+    ofParameter<int> droppedScans;      // scans dropped because the queue was full
+    ofParameter<int> segmentMB;         // start a new segment file once one reaches this size (0 for no limit)
+    ofParameter<int> segmentMinutes;    // start a new segment file once one holds this long (0 for no limit)
+    ofParameter<int> currentSegment;    // segment being written
+    ofParameter<bool> statsEnabled;     // time each stage of receiving and recording scans
+    ofParameter<float> statsInterval;   // seconds between stats reports
+    ofParameter<int> statsOscPort;      // port on localhost to send stats to (0 for none)
+    ofParameter<string> sensorPorts;    // osc ports to receive from, one per sensor (comma separated; set in settings.xml)
+    ofParameter<int> renderSensor;      // which sensor the realtime render shows
+    ofParameter<bool> backgroundSubtraction;    // pick out the beams in front of each sensor's background
+    ofParameter<bool> resetBackground;          // flag to learn the background again
+    ofParameter<float> backgroundStep;          // mm the background moves towards each scan at most
+    ofParameter<int> foregroundDistance;        // mm nearer than the background a foreground beam has to be
+    ofParameter<float> foregroundDeviations;    // and how many of the beam's deviations nearer
+    ofParameter<bool> recordForegroundOnly;     // record background beams as no return
+    ofParameter<int> foregroundOscPort;         // port on localhost to send foreground beams to (0 for none)
+    ofParameter<int> foregroundBeams;           // foreground beams in the render sensor's last scan
+    ofParameter<bool> blobTracking;             // follow blobs from scan to scan
+    ofParameter<int> blobDistance;              // mm between neighbouring returns of a blob at most
+    ofParameter<int> minBlobBeams;              // beams a blob has at least
+    ofParameter<int> trackMatchDistance;        // mm a blob can be from where a track was heading and continue it
+    ofParameter<int> trackerOscPort;            // port on localhost to send tracks to (0 for none)
+    ofParameter<int> trackedBlobs;              // tracks in the render sensor's last scan
     ofParameterGroup recordingParams;
     
     // ------------ CONNECT OSC -------------
     
-    // connect to specified port
+    // connect to the ports in sensorPorts, or to specified ports; each port is one sensor
     // default port is the same port specified in settings.xml of ofxURG's sender app
-    void setup(int port = 7777);
-    int oscPort;
+    void setup();
+    void setup(int port);
+    void setup(const vector<int>& ports);
     
-    // receives data over osc
-    ofxOscReceiver receiver;
+    // one sensor: its scans are received on a thread of its own, timed as they
+    // arrive against the same clock as every other sensor's, and written to a
+    // file of its own
+    struct sensorStream {
+        int port;
+        urgScanReceiver receiver;
+        urgRecordWriter writer;
+        
+        // sin/cos of the sensor's beam angles, learned from its first scan
+        urgBeamTable beamTable;
+        
+        // the header of a binary recording is made with the first scan, once the beam count is known
+        bool binaryHeaderWritten = false;
+        
+        // whether the last scan had any returns
+        bool live = false;
+        
+        // scans received, and scans with exactly the same ranges as the one before
+        unsigned long receivedScans = 0;
+        unsigned long duplicatedScans = 0;
+        vector<int32_t> lastRanges;
+        
+        // what the sensor sees with nothing in the way, and which beams of the
+        // last scan weren't that (one flag per beam)
+        urgBackgroundModel background;
+        vector<uint8_t> foreground;
+        
+        // beams run through the background model, and how many were foreground
+        unsigned long modelledBeams = 0;
+        unsigned long foregroundBeams = 0;
+        
+        // the blobs in front of the sensor, followed from scan to scan
+        urgBlobTracker tracker;
+    };
+    vector<shared_ptr<sensorStream> > sensors;
     
     // determine if we're getting data
     unsigned long lastDataTime = 0;
@@ -63,20 +134,54 @@ public:
     
     void update();
     
-    // file where data is recorded to
-    ofFile recFile;
+    // each sensor's writer writes its data to a recording file on its own thread
+    // (one file per sensor, named <timestamp>_recording_<port> when there's more than one)
     /* format of data (time in milliseconds, points in millimeters):
         time    x1     y1      x2      y2      x3      y3  ...
         .
         .
         .
+       or, if binaryFormat, compressedFormat or polarFormat is set, one of the
+       binary layouts described in urgFormat.h
      */
     
-    // counter of number of scans recorded to file
+    // format of the current recording (fixed when the recording starts)
+    urgRecordingFormat recordingFormat = URG_FORMAT_CSV;
+    
+    // handle one scan from a sensor
+    void addScan(sensorStream& sensor, bool render, bool timed);
+    
+    // while backgroundSubtraction is set, each scan updates its sensor's
+    // background model, and the beams in front of the background are sent to
+    // foregroundOscPort as a /urg/foreground message: the sensor's port, the
+    // scan's time (ms), then the index and range (mm) of each foreground beam;
+    // with recordForegroundOnly, only they are recorded (the others as ranges
+    // of 0, so a mostly static scene compresses to little)
+    void subtractBackground(sensorStream& sensor, unsigned long time, bool render, bool timed);
+    ofxOscSender foregroundSender;
+    int foregroundSenderPort = 0;
+    
+    // while blobTracking is set, each scan's blobs (only its foreground ones
+    // with backgroundSubtraction) continue the tracks of its sensor's scans
+    // before, and the tracks are sent to trackerOscPort as a /urg/tracker/data
+    // message of id, x, y (mm) for each track, as the external tracker did;
+    // ids are unique over all the sensors
+    void trackBlobs(sensorStream& sensor, unsigned long time, bool render, bool timed);
+    ofxOscSender trackerSender;
+    int trackerSenderPort = 0;
+    
+    // ranges (mm) and angles (radians) of the scan being received, and its
+    // interleaved x/y; reused between scans
+    vector<int32_t> scanRanges;
+    vector<float> scanAngles;
+    vector<float> scanPoints;
+    
+    // counter of number of scans recorded to file (from every sensor)
     unsigned long scanCounter = 0;
     
-    // mesh to store the most recent scan (in XY plane)
-    ofMesh lastScan;
+    // most recent scans (in XY plane), newest first, for a realtime render
+    // holds as many scans as nMeshes can be set to, so changing nMeshes keeps the history
+    urgScanHistory history;
     /* Orientation of data received:
            y
            |
@@ -91,18 +196,47 @@ public:
          '   '
     */
     
-    // stores last nMeshes meshes for a realtime render of recent scans
-    vector<ofMesh> scans;
+    // stores the beginning time of a recording (urgMicros() when its first scan
+    // arrived from any sensor), so every sensor's times share one time base
+    uint64_t timeZero = 0;
     
-    // stores the beginning time of a recording
-    unsigned long timeZero;
+    // timeZero as unix time (ms), the start time in every sensor's header
+    uint64_t timeZeroUnixMillis = 0;
     
     // last 341 reading
     float lastSample = 0.;
     
-    // tracker data points
+    // tracked blobs of the render sensor's last scan, by id (mm)
     map<int, ofVec2f> points;
     
+    // ------------ STATS -------------
+    
+    // while statsEnabled is set, every statsInterval seconds the stats below
+    // (and the writers', over every sensor) are written to statsFileName as one
+    // "name key=value ..." line per stat, sent as /urg/stats/<name> messages if
+    // statsOscPort is set, and reset; each sensor's counters follow on a line of their own
+    void reportStats();
+    string statsFileName = "recorder_stats.txt";
+    
+    // scans drained per frame, and microseconds from a scan's arrival until
+    // it's drained, to convert it, to add it to the realtime render, to
+    // run it through the background model and to track its blobs
+    urgHistogram drainedMessages;
+    urgHistogram queueTimes;
+    urgHistogram convertTimes;
+    urgHistogram renderTimes;
+    urgHistogram backgroundTimes;
+    urgHistogram trackerTimes;
+    
+    // the writers' histograms, merged over every sensor for a report
+    urgHistogram formatTimes;
+    urgHistogram writeTimes;
+    urgHistogram lagTimes;
+    
+    uint64_t lastStatsReport = 0;
+    ofxOscSender statsSender;
+    int statsSenderPort = 0;
+    
     // ------------ RENDER DATA -------------
     
     // draw the point data to screen as it's being received or recorded
@@ -0,0 +1,127 @@
+//
+//  urgScanHistory.cpp
+//  urg_record
+//
+//  Fixed-capacity ring of the most recent scans for the real-time render.
+//  Every slot is preallocated in one contiguous vertex array (with the
+//  slots' times and point counts kept in parallel arrays), so adding a
+//  scan overwrites the oldest slot in place instead of copying meshes.
+//
+
+#include "urgScanHistory.h"
+
+void urgScanHistory::setup(int capacity_, int nBeams) {
+
+    capacity = max(capacity_, 1);
+    slotBeams = 0;
+    vertices.clear();
+    nPoints.assign(capacity, 0);
+    times.assign(capacity, 0);
+    clear();
+
+    if (nBeams > 0) resizeSlots(nBeams);
+}
+
+// ---------------------------------------------------------------------
+
+void urgScanHistory::resizeSlots(int nBeams) {
+
+    // copy each slot's points to where the slot starts in the new layout
+    vector<ofVec3f> resized((size_t)capacity * nBeams, ofVec3f(0, 0, 0));
+    for (int s = 0; s < capacity; s++) {
+        if (nPoints[s] > 0) copy(&vertices[s * slotBeams], &vertices[s * slotBeams] + nPoints[s], &resized[s * nBeams]);
+    }
+    vertices.swap(resized);
+    slotBeams = nBeams;
+
+    vbo.setVertexData(vertices.data(), vertices.size(), GL_DYNAMIC_DRAW);
+    vboDirty = false;
+}
+
+// ---------------------------------------------------------------------
+
+void urgScanHistory::push(unsigned long time, const float* xy, int nBeams) {
+
+    if (capacity == 0) setup();
+
+    // the first scan sizes the slots; a sensor with more beams than they
+    // hold (another sensor rendered) widens them, keeping the scans held
+    if (nBeams > slotBeams) {
+        if (slotBeams > 0) ofLogNotice("urgScanHistory") << "resizing history for " << nBeams << " beams";
+        resizeSlots(nBeams);
+    }
+
+    head = (head + 1) % capacity;
+    count = min(count + 1, capacity);
+
+    // write the scan over the oldest slot (in the XY plane)
+    ofVec3f* slot = &vertices[head * slotBeams];
+    for (int i = 0; i < nBeams; i++) {
+        slot[i].x = xy[2 * i];
+        slot[i].y = xy[2 * i + 1];
+        slot[i].z = 0;
+    }
+    nPoints[head] = nBeams;
+    times[head] = time;
+
+    vboDirty = true;
+}
+
+// ---------------------------------------------------------------------
+
+void urgScanHistory::clear() {
+
+    head = -1;
+    count = 0;
+}
+
+// ---------------------------------------------------------------------
+
+int urgScanHistory::size() {
+    return count;
+}
+
+// ---------------------------------------------------------------------
+
+int urgScanHistory::getCapacity() {
+    return capacity;
+}
+
+// ---------------------------------------------------------------------
+
+int urgScanHistory::slotOf(int i) {
+    return (head - i + capacity) % capacity;
+}
+
+// ---------------------------------------------------------------------
+
+const ofVec3f* urgScanHistory::getPoints(int i) {
+    return &vertices[slotOf(i) * slotBeams];
+}
+
+// ---------------------------------------------------------------------
+
+int urgScanHistory::getNumPoints(int i) {
+    return nPoints[slotOf(i)];
+}
+
+// ---------------------------------------------------------------------
+
+unsigned long urgScanHistory::getTime(int i) {
+    return times[slotOf(i)];
+}
+
+// ---------------------------------------------------------------------
+
+void urgScanHistory::drawScan(int i) {
+
+    if (i >= count) return;
+
+    if (vboDirty) {
+        vbo.updateVertexData(vertices.data(), vertices.size());
+        vboDirty = false;
+    }
+
+    int slot = slotOf(i);
+    vbo.draw(GL_POINTS, slot * slotBeams, nPoints[slot]);
+}
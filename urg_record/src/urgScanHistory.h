@@ -0,0 +1,67 @@
+//
+//  urgScanHistory.h
+//  urg_record
+//
+//  Fixed-capacity ring of the most recent scans for the real-time render.
+//  Every slot is preallocated in one contiguous vertex array (with the
+//  slots' times and point counts kept in parallel arrays), so adding a
+//  scan overwrites the oldest slot in place instead of copying meshes.
+//
+
+#ifndef __urg_record__urgScanHistory__
+#define __urg_record__urgScanHistory__
+
+#include "ofMain.h"
+
+class urgScanHistory {
+
+public:
+
+    // allocate room for capacity scans of up to nBeams beams (clears the history);
+    // with nBeams 0, the slots are sized by the first scan pushed
+    void setup(int capacity = 512, int nBeams = 0);
+
+    // add a scan of interleaved x/y (mm), replacing the oldest if the ring is full
+    void push(unsigned long time, const float* xy, int nBeams);
+
+    void clear();
+
+    // number of scans held, and the most that can be held
+    int size();
+    int getCapacity();
+
+    // scan i, counting back from the newest (i = 0)
+    const ofVec3f* getPoints(int i);
+    int getNumPoints(int i);
+    unsigned long getTime(int i);
+
+    // draw scan i with the current transform
+    void drawScan(int i);
+
+private:
+
+    // slot holding scan i
+    int slotOf(int i);
+
+    // make every slot hold nBeams beams, keeping the scans held
+    void resizeSlots(int nBeams);
+
+    int capacity = 0;
+    int slotBeams = 0;
+
+    // slot of the newest scan and number of scans held
+    int head = -1;
+    int count = 0;
+
+    // capacity * slotBeams points, slot s starting at s * slotBeams
+    vector<ofVec3f> vertices;
+    vector<int> nPoints;
+    vector<unsigned long> times;
+
+    // the vertices are uploaded to the gpu when they've changed since the last draw
+    ofVbo vbo;
+    bool vboDirty = true;
+
+};
+
+#endif /* defined(__urg_record__urgScanHistory__) */
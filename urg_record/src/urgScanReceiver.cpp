@@ -0,0 +1,114 @@
+//
+//  urgScanReceiver.cpp
+//  urg_record
+//
+//  Receives scans over OSC on a thread of its own, so they're timed when
+//  they arrive rather than when the main thread next gets to them (which
+//  stamped scans that arrived a frame apart with nearly the same time).
+//  Each /urg/raw/data message is stamped with urgMicros(), parsed into a
+//  preallocated slot and handed over through a lock-free SPSC queue.
+//
+
+#include "urgScanReceiver.h"
+
+// microseconds to wait when no messages are waiting; the most a scan's
+// arrival time can be late by
+#define URG_RECEIVE_POLL_US 250
+
+urgScanReceiver::urgScanReceiver() {
+
+    receivedScans = 0;
+    droppedScans = 0;
+}
+
+// ---------------------------------------------------------------------
+
+urgScanReceiver::~urgScanReceiver() {
+
+    close();
+}
+
+// ---------------------------------------------------------------------
+
+void urgScanReceiver::setup(int port, int capacity, int nBeams) {
+
+    close();
+
+    // preallocate every slot so receiving a scan never allocates
+    queue.setup(max(capacity, 1));
+    for (size_t i = 0; i < queue.getCapacity(); i++) {
+        queue.getSlot(i).ranges.reserve(nBeams);
+        queue.getSlot(i).angles.reserve(nBeams);
+    }
+    receivedScans = 0;
+    droppedScans = 0;
+
+    receiver.setup(port);
+    startThread();
+}
+
+// ---------------------------------------------------------------------
+
+void urgScanReceiver::close() {
+
+    if (isThreadRunning()) waitForThread(true);
+}
+
+// ---------------------------------------------------------------------
+
+urgReceivedScan* urgScanReceiver::front() {
+    return queue.front();
+}
+
+void urgScanReceiver::pop() {
+    queue.pop();
+}
+
+int urgScanReceiver::getQueueDepth() {
+    return queue.size();
+}
+
+unsigned long urgScanReceiver::getReceivedScans() {
+    return receivedScans;
+}
+
+unsigned long urgScanReceiver::getDroppedScans() {
+    return droppedScans;
+}
+
+// ---------------------------------------------------------------------
+
+void urgScanReceiver::threadedFunction() {
+
+    ofxOscMessage m;
+
+    while (isThreadRunning()) {
+
+        if (!receiver.getNextMessage(m)) {
+            std::this_thread::sleep_for(std::chrono::microseconds(URG_RECEIVE_POLL_US));
+            continue;
+        }
+        uint64_t arrival = urgMicros();
+
+        if (m.getAddress() != "/urg/raw/data") continue;
+        receivedScans++;
+
+        // the main thread is behind: drop the newest scan rather than block
+        urgReceivedScan* scan = queue.back();
+        if (scan == NULL) {
+            droppedScans++;
+            continue;
+        }
+
+        // ranges and angles alternate
+        int nBeams = m.getNumArgs() / 2;
+        scan->arrival = arrival;
+        scan->ranges.resize(nBeams);
+        scan->angles.resize(nBeams);
+        for (int i = 0; i < nBeams; i++) {
+            scan->ranges[i] = m.getArgAsInt32(2 * i);
+            scan->angles[i] = m.getArgAsFloat(2 * i + 1);
+        }
+        queue.push();
+    }
+}
@@ -0,0 +1,65 @@
+//
+//  urgScanReceiver.h
+//  urg_record
+//
+//  Receives scans over OSC on a thread of its own, so they're timed when
+//  they arrive rather than when the main thread next gets to them (which
+//  stamped scans that arrived a frame apart with nearly the same time).
+//  Each /urg/raw/data message is stamped with urgMicros(), parsed into a
+//  preallocated slot and handed over through a lock-free SPSC queue.
+//
+
+#ifndef __urg_record__urgScanReceiver__
+#define __urg_record__urgScanReceiver__
+
+#include "ofMain.h"
+#include "ofxOsc.h"
+#include "urgSpscQueue.h"
+#include "urgStats.h"
+
+// a scan as it arrived
+struct urgReceivedScan {
+    uint64_t arrival;           // urgMicros() when the message was received
+    vector<int32_t> ranges;     // mm, one per beam
+    vector<float> angles;       // radians, one per beam
+};
+
+class urgScanReceiver : public ofThread {
+
+public:
+
+    urgScanReceiver();
+    ~urgScanReceiver();
+
+    // listen on port and start the receive thread, with room for capacity
+    // scans of up to nBeams beams waiting to be taken
+    void setup(int port, int capacity = 1024, int nBeams = 682);
+
+    // stop the receive thread
+    void close();
+
+    // the oldest scan not yet taken, or NULL if there is none; pop() lets
+    // the receive thread reuse it (call both from one thread only)
+    urgReceivedScan* front();
+    void pop();
+
+    // scans waiting to be taken
+    int getQueueDepth();
+
+    // scans received, and scans dropped because the queue was full
+    unsigned long getReceivedScans();
+    unsigned long getDroppedScans();
+
+private:
+
+    void threadedFunction();
+
+    ofxOscReceiver receiver;
+    urgSpscQueue<urgReceivedScan> queue;
+
+    std::atomic<unsigned long> receivedScans;
+    std::atomic<unsigned long> droppedScans;
+
+};
+
+#endif /* defined(__urg_record__urgScanReceiver__) */
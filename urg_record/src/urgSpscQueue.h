@@ -0,0 +1,89 @@
+//
+//  urgSpscQueue.h
+//  urg_record
+//
+//  Lock-free ring of preallocated slots between exactly one producer thread
+//  and one consumer thread. Each side fills or reads a slot in place and
+//  then publishes it with a single atomic store, so handing over a scan
+//  never locks or allocates.
+//
+
+#ifndef __urg_record__urgSpscQueue__
+#define __urg_record__urgSpscQueue__
+
+#include "ofMain.h"
+#include <atomic>
+
+template<class T>
+class urgSpscQueue {
+
+public:
+
+    urgSpscQueue() : head(0), tail(0) {}
+
+    // room for at least capacity items (rounded up to a power of two); slots
+    // are default constructed and kept, so they can be given room up front
+    // through getSlot() (only while neither thread is using the queue)
+    void setup(size_t capacity) {
+        size_t n = 1;
+        while (n < capacity) n <<= 1;
+        slots.assign(n, T());
+        mask = n - 1;
+        head = 0;
+        tail = 0;
+    }
+
+    size_t getCapacity() {
+        return slots.size();
+    }
+
+    T& getSlot(size_t i) {
+        return slots[i];
+    }
+
+    // producer: the slot to fill next, or NULL if the queue is full;
+    // push() then hands it to the consumer
+    T* back() {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == slots.size()) return NULL;
+        return &slots[t & mask];
+    }
+
+    void push() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // consumer: the oldest item, or NULL if the queue is empty; pop() then
+    // gives its slot back to the producer
+    T* front() {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return NULL;
+        return &slots[h & mask];
+    }
+
+    void pop() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // items waiting (exact from either thread's point of view, approximate otherwise)
+    size_t size() {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+private:
+
+    vector<T> slots;
+    size_t mask = 0;
+
+    // items popped and pushed so far; padded onto separate cache lines so
+    // the two threads don't contend for one (padding rather than alignas,
+    // which operator new doesn't honor before C++17)
+    char padBefore[64];
+    std::atomic<size_t> head;
+    char padBetween[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail;
+    char padAfter[64 - sizeof(std::atomic<size_t>)];
+
+};
+
+#endif /* defined(__urg_record__urgSpscQueue__) */
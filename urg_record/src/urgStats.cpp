@@ -0,0 +1,122 @@
+//
+//  urgStats.cpp
+//  urg_record
+//
+//  Lock-free histograms for the recorder's instrumentation. Values (usually
+//  microseconds) fall into buckets about 12% wide, so adding one is a few
+//  shifts and an atomic increment, from any thread, without allocating.
+//
+
+#include "urgStats.h"
+#include <chrono>
+
+uint64_t urgMicros() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// ---------------------------------------------------------------------
+
+urgHistogram::urgHistogram() {
+    reset();
+}
+
+// ---------------------------------------------------------------------
+
+int urgHistogram::bucketOf(uint64_t value) {
+
+    if (value < 8) return value;
+
+    // the position of the top bit picks the power of two, the next three bits the bucket within it
+    int top = 3;
+    while (top < 63 && (value >> (top + 1)) != 0) top++;
+    int bucket = (top - 2) * 8 + ((value >> (top - 3)) & 7);
+    return min(bucket, URG_HISTOGRAM_BUCKETS - 1);
+}
+
+// ---------------------------------------------------------------------
+
+uint64_t urgHistogram::bucketTop(int bucket) {
+
+    if (bucket < 8) return bucket;
+
+    int top = bucket / 8 + 2;
+    uint64_t sub = bucket % 8;
+    return ((8 + sub + 1) << (top - 3)) - 1;
+}
+
+// ---------------------------------------------------------------------
+
+void urgHistogram::add(uint64_t value) {
+
+    buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t current = maxValue.load(std::memory_order_relaxed);
+    while (value > current && !maxValue.compare_exchange_weak(current, value, std::memory_order_relaxed));
+}
+
+// ---------------------------------------------------------------------
+
+void urgHistogram::reset() {
+
+    for (int i = 0; i < URG_HISTOGRAM_BUCKETS; i++) buckets[i] = 0;
+    count = 0;
+    sum = 0;
+    maxValue = 0;
+}
+
+// ---------------------------------------------------------------------
+
+void urgHistogram::take(urgHistogram& other) {
+
+    // swap each counter for zero rather than reading then resetting it, so an
+    // add() landing in between isn't lost
+    for (int i = 0; i < URG_HISTOGRAM_BUCKETS; i++) {
+        buckets[i].fetch_add(other.buckets[i].exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    count.fetch_add(other.count.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+    sum.fetch_add(other.sum.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+
+    uint64_t value = other.maxValue.exchange(0, std::memory_order_relaxed);
+    uint64_t current = maxValue.load(std::memory_order_relaxed);
+    while (value > current && !maxValue.compare_exchange_weak(current, value, std::memory_order_relaxed));
+}
+
+// ---------------------------------------------------------------------
+
+uint64_t urgHistogram::getCount() {
+    return count;
+}
+
+// ---------------------------------------------------------------------
+
+uint64_t urgHistogram::getMax() {
+    return maxValue;
+}
+
+// ---------------------------------------------------------------------
+
+double urgHistogram::getMean() {
+
+    uint64_t n = count;
+    return (n > 0) ? (double)sum / n : 0;
+}
+
+// ---------------------------------------------------------------------
+
+uint64_t urgHistogram::getPercentile(double p) {
+
+    uint64_t n = count;
+    if (n == 0) return 0;
+
+    // the bucket holding the value ranked p percent of the way up
+    uint64_t rank = max((uint64_t)1, (uint64_t)ceil(n * ofClamp(p, 0, 100) / 100.));
+    uint64_t seen = 0;
+    for (int i = 0; i < URG_HISTOGRAM_BUCKETS; i++) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) return min(bucketTop(i), getMax());
+    }
+    return getMax();
+}
@@ -0,0 +1,59 @@
+//
+//  urgStats.h
+//  urg_record
+//
+//  Lock-free histograms for the recorder's instrumentation. Values (usually
+//  microseconds) fall into buckets about 12% wide, so adding one is a few
+//  shifts and an atomic increment, from any thread, without allocating.
+//
+
+#ifndef __urg_record__urgStats__
+#define __urg_record__urgStats__
+
+#include "ofMain.h"
+#include <atomic>
+
+// 8 exact buckets for 0-7, then 8 buckets per power of two up to 2^63
+#define URG_HISTOGRAM_BUCKETS (8 * 62)
+
+// microseconds on a steady clock, for timing stages and lag
+uint64_t urgMicros();
+
+class urgHistogram {
+
+public:
+
+    urgHistogram();
+
+    // count one value (any thread)
+    void add(uint64_t value);
+
+    // forget every value
+    void reset();
+
+    // count every value another histogram has counted, and empty it; safe
+    // while other threads add to it, as each value moves over exactly once
+    void take(urgHistogram& other);
+
+    uint64_t getCount();
+    uint64_t getMax();
+    double getMean();
+
+    // value below which p percent of the values fall (to within a bucket)
+    uint64_t getPercentile(double p);
+
+private:
+
+    static int bucketOf(uint64_t value);
+
+    // largest value that falls in a bucket
+    static uint64_t bucketTop(int bucket);
+
+    std::atomic<uint32_t> buckets[URG_HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> maxValue;
+
+};
+
+#endif /* defined(__urg_record__urgStats__) */
@@ -0,0 +1,190 @@
+//
+//  main.cpp
+//  urg_sender
+//
+//  Command-line stand-in for the sensors, for load testing urg_record
+//  without the hardware. Sends synthetic /urg/raw/data scans (range and
+//  angle pairs, as the sensor's bridge does) to one or more ports, each
+//  from a thread of its own and paced to a fixed rate.
+//
+//      urg_sender [options]
+//
+//  Run with --help for the list of options. The recorder's stats
+//  (Enable Stats) show how it keeps up with what was sent.
+//
+
+#include "ofMain.h"
+#include "ofxOsc.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// seconds since an arbitrary point
+static double now() {
+    using namespace std::chrono;
+    return duration_cast<duration<double>>(steady_clock::now().time_since_epoch()).count();
+}
+
+// ---------------------------------------------------------------------
+
+// everything given on the command line
+struct senderSettings {
+
+    string host = "localhost";
+    vector<int> ports = vector<int>(1, 7777);
+    float rate = 10;            // scans / sec per port
+    int nBeams = 682;
+    float seconds = 10;         // 0 to send until killed
+    float fieldOfView = 240;    // degrees covered by the beams
+};
+
+// what one port's thread sent
+struct senderResult {
+    unsigned long nScans = 0;
+    double seconds = 0;
+    double maxLate = 0;         // sec the thread fell behind its schedule by at most
+};
+
+// ---------------------------------------------------------------------
+
+static void printUsage() {
+
+    cout << "usage: urg_sender [options]\n"
+            "\n"
+            "sends synthetic scans to urg_record, one thread per port\n"
+            "\n"
+            "  --host HOST              where to send (localhost)\n"
+            "  --ports P[,P...]         ports to send to, one sensor each (7777)\n"
+            "  --rate HZ                scans / sec per port (10)\n"
+            "  --beams N                beams per scan (682)\n"
+            "  --fov DEG                degrees covered by the beams (240)\n"
+            "  --seconds S              how long to send, 0 for until killed (10)\n";
+}
+
+// ---------------------------------------------------------------------
+
+// parse the command line; returns false (after saying why) if it's unusable
+static bool parseArguments(int argc, char** argv, senderSettings& settings) {
+
+    for (int i = 1; i < argc; i++) {
+
+        string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return false;
+        }
+
+        // every option has a value
+        if (i + 1 >= argc) {
+            cerr << "urg_sender: " << arg << " needs a value" << endl;
+            return false;
+        }
+        string value = argv[++i];
+
+        if (arg == "--host") settings.host = value;
+        else if (arg == "--ports") {
+            settings.ports.clear();
+            vector<string> items = ofSplitString(value, ",", true, true);
+            for (size_t p = 0; p < items.size(); p++) settings.ports.push_back(ofToInt(items[p]));
+        }
+        else if (arg == "--rate") settings.rate = ofToFloat(value);
+        else if (arg == "--beams") settings.nBeams = ofToInt(value);
+        else if (arg == "--fov") settings.fieldOfView = ofToFloat(value);
+        else if (arg == "--seconds") settings.seconds = ofToFloat(value);
+        else {
+            cerr << "urg_sender: unknown option " << arg << endl;
+            return false;
+        }
+    }
+
+    if (settings.ports.empty() || settings.rate <= 0 || settings.nBeams <= 0) {
+        printUsage();
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------
+
+// send scans to one port until the time is up; the scene is a room with a
+// wall that moves back and forth, so consecutive scans differ
+static senderResult sendScans(const senderSettings& settings, int port) {
+
+    senderResult result;
+
+    ofxOscSender sender;
+    sender.setup(settings.host, port);
+
+    // beam angles don't change from scan to scan
+    vector<float> angles(settings.nBeams);
+    float fov = ofDegToRad(settings.fieldOfView);
+    for (int i = 0; i < settings.nBeams; i++) {
+        angles[i] = -fov / 2 + (settings.nBeams > 1 ? fov * i / (settings.nBeams - 1) : 0);
+    }
+
+    ofxOscMessage m;
+    double period = 1. / settings.rate;
+    double start = now();
+    double next = start;
+
+    while (settings.seconds <= 0 || next - start < settings.seconds) {
+
+        // wait for this scan's turn
+        double t = now();
+        if (next > t) std::this_thread::sleep_for(std::chrono::duration<double>(next - t));
+        else result.maxLate = max(result.maxLate, t - next);
+
+        // a wall 2-3 m away, a little noise, and a few beams with no return
+        float wall = 2500 + 500 * sin((next - start) * 0.5 + port);
+        m.clear();
+        m.setAddress("/urg/raw/data");
+        for (int i = 0; i < settings.nBeams; i++) {
+            int32_t range = (i % 97 == 0) ? 0 : (int32_t)(wall / max(cos(angles[i] / 3), 0.1f)) + (int32_t)ofRandom(-5, 5);
+            m.addIntArg(range);
+            m.addFloatArg(angles[i]);
+        }
+        sender.sendMessage(m, false);
+
+        result.nScans++;
+        next += period;
+    }
+
+    result.seconds = now() - start;
+    return result;
+}
+
+//========================================================================
+int main(int argc, char** argv) {
+
+    senderSettings settings;
+    if (!parseArguments(argc, argv, settings)) return 1;
+
+    int nPorts = settings.ports.size();
+    vector<senderResult> results(nPorts);
+
+    cout << "sending " << settings.nBeams << " beams at " << settings.rate << " Hz to "
+         << settings.host << " on " << nPorts << " port(s)" << endl;
+
+    // one thread per port, as one receive thread per sensor listens on the other end
+    vector<std::thread> threads;
+    for (int p = 0; p < nPorts; p++) {
+        threads.push_back(std::thread([&settings, &results, p]() {
+            results[p] = sendScans(settings, settings.ports[p]);
+        }));
+    }
+    for (size_t t = 0; t < threads.size(); t++) threads[t].join();
+
+    // what was actually achieved on each port
+    unsigned long nScans = 0;
+    for (int p = 0; p < nPorts; p++) {
+        const senderResult& r = results[p];
+        nScans += r.nScans;
+        cout << "port " << settings.ports[p] << " scans=" << r.nScans
+             << " seconds=" << r.seconds
+             << " scans_per_s=" << (r.seconds > 0 ? r.nScans / r.seconds : 0)
+             << " max_late_ms=" << r.maxLate * 1000 << endl;
+    }
+    cout << "total scans=" << nScans << endl;
+
+    return 0;
+}